@@ -0,0 +1,40 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+Arena::~Arena() {
+	for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+		it->second(it->first);
+	}
+}
+
+void Arena::adopt(Arena &other) {
+	// the last block stays last, so this arena keeps allocating from it
+	blocks.insert(blocks.begin(), std::make_move_iterator(other.blocks.begin()), std::make_move_iterator(other.blocks.end()));
+	destructors.insert(destructors.end(), other.destructors.begin(), other.destructors.end());
+	used += other.used;
+	reserved += other.reserved;
+	other.blocks.clear();
+	other.destructors.clear();
+	other.current = nullptr;
+	other.remaining = other.used = other.reserved = 0;
+}
+
+void *Arena::allocate(size_t size, size_t alignment) {
+	size_t padding = -(uintptr_t)current & (alignment - 1);
+	if (padding + size > remaining) {
+		// objects bigger than a block get a block of their own
+		size_t newBlockSize = std::max(blockSize, size + alignment);
+		blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(newBlockSize));
+		current = blocks.back().get();
+		remaining = newBlockSize;
+		reserved += newBlockSize;
+		padding = -(uintptr_t)current & (alignment - 1);
+	}
+	void *result = current + padding;
+	current += padding + size;
+	remaining -= padding + size;
+	used += size;
+	return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A bump allocator which owns the objects created in it.
+// Objects can't be freed one by one: they're destroyed together, in reverse creation order, when the arena is destroyed.
+class Arena {
+  public:
+	Arena() = default;
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+	~Arena();
+
+	// construct an object in the arena. it lives as long as the arena
+	template <typename T, typename... Arguments> T *create(Arguments &&...arguments) {
+		T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Arguments>(arguments)...);
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			destructors.emplace_back(object, [](void *pointer) { static_cast<T *>(pointer)->~T(); });
+		}
+		return object;
+	}
+
+	// construct an array of value-initialised objects in the arena. it lives as long as the arena
+	template <typename T> std::span<T> createArray(size_t count) {
+		static_assert(std::is_trivially_destructible_v<T>, "array elements aren't destroyed");
+		T *objects = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+		std::uninitialized_value_construct_n(objects, count);
+		return {objects, count};
+	}
+
+	// take over the objects of another arena, which is left empty. they live as long as this arena
+	void adopt(Arena &other);
+
+	// bytes handed out to objects
+	size_t usedBytes() const { return used; }
+	// bytes requested from the system
+	size_t reservedBytes() const { return reserved; }
+
+  private:
+	static constexpr size_t blockSize = 64 * 1024;
+
+	void *allocate(size_t size, size_t alignment);
+
+	std::vector<std::unique_ptr<std::byte[]>> blocks;
+	// the free part of the last block
+	std::byte *current{};
+	size_t remaining{};
+	size_t used{};
+	size_t reserved{};
+	// objects with a destructor, in creation order
+	std::vector<std::pair<void *, void (*)(void *)>> destructors;
+};
@@ -0,0 +1,60 @@
+#include "classSection.h"
+#include "compiler.h"
+#include "expression.h"
+#include "patternMatch.h"
+#include "variable.h"
+
+// the arguments are bound to the parameters the match passed, in the order they appear in the line
+static void bindParameters(ParseContext &context, Expression *call) {
+	PatternDefinition *definition = call->patternMatch->matchedEndNode->matchingDefinition;
+	std::vector<Expression *> sortedArgs = sortArgumentsByPosition(call->arguments);
+	std::vector<ParameterBinding> bindings;
+	for (PatternTreeNode *node : call->patternMatch->nodesPassed) {
+		uint32_t parameterName = node->parameterName(definition);
+		if (parameterName != noSymbol && bindings.size() < sortedArgs.size()) {
+			Expression *argument = sortedArgs[bindings.size()];
+			bool isVariable = argument->kind == Expression::Kind::Variable && argument->variable;
+			bindings.push_back({parameterName, argument, isVariable});
+		}
+	}
+	call->parameterBindings = context.arena.createArray<ParameterBinding>(bindings.size());
+	std::copy(bindings.begin(), bindings.end(), call->parameterBindings.begin());
+}
+
+static void bindExpression(ParseContext &context, Expression *expr) {
+	for (Expression *arg : expr->arguments)
+		bindExpression(context, arg);
+
+	if (expr->kind == Expression::Kind::Variable && expr->variable) {
+		VariableReference *reference = expr->variable;
+		Section *section = expr->range.line ? expr->range.line->section : nullptr;
+		reference->resolved = section ? section->findVariable(reference->name) : nullptr;
+		reference->symbol = context.symbols.intern(reference->name);
+	} else if (expr->kind == Expression::Kind::PatternCall && expr->patternMatch && expr->patternMatch->matchedEndNode) {
+		bindParameters(context, expr);
+	}
+}
+
+static void bindSection(ParseContext &context, Section *section) {
+	if (section->variableTables) {
+		for (auto &[name, definition] : section->variableTables->definitions)
+			definition->resolved = section->findVariable(name);
+	}
+	if (section->type == SectionType::Class) {
+		ClassDefinition *classDef = static_cast<ClassSection *>(section)->classDefinition;
+		classDef->fieldSymbols.clear();
+		for (const FieldDefinition &field : classDef->fields)
+			classDef->fieldSymbols.push_back(context.symbols.intern(field.name));
+	}
+	for (Section *child : section->children)
+		bindSection(context, child);
+}
+
+bool bindVariables(ParseContext &context) {
+	for (CodeLine *line : context.codeLines) {
+		if (line->expression && line->section->reachable)
+			bindExpression(context, line->expression);
+	}
+	bindSection(context, context.mainSection);
+	return true;
+}
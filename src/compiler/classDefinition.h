@@ -1,6 +1,7 @@
 #pragma once
 #include "range.h"
 #include "type.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -25,6 +26,17 @@ struct ClassDefinition {
 	std::vector<ClassInstantiation> instantiations;
 	int alignment = 0; // Struct alignment in bytes (0 = natural)
 	Range range;
+	// the interned names of the fields (set by bindVariables)
+	std::vector<uint32_t> fieldSymbols;
+
+	// returns -1 if no field has the name
+	int fieldIndex(uint32_t symbol) const {
+		for (size_t index = 0; index < fieldSymbols.size(); index++) {
+			if (fieldSymbols[index] == symbol)
+				return (int)index;
+		}
+		return -1;
+	}
 
 	// Find or create instantiation for given field types. Returns index.
 	int getOrCreateInstantiation(const std::vector<Type> &fieldTypes) {
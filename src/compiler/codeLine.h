@@ -29,6 +29,8 @@ struct CodeLine {
 	std::string_view fullText;
 	// the text without comments and right-trimmed
 	std::string_view rightTrimmedText{};
+	// the leading whitespace of rightTrimmedText
+	std::string_view indentation{};
 	// the pattern part of the line. excludes system patterns.
 	std::string_view patternText{};
 
@@ -4,9 +4,11 @@
 #include "compiler.h"
 #include "compilerUtils.h"
 #include "expression.h"
+#include "jit.h"
 #include "native.h"
 #include "patternDefinition.h"
 #include "patternReference.h"
+#include "target.h"
 #include "type.h"
 #include "variable.h"
 #include "llvm/IR/CFG.h"
@@ -15,8 +17,9 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
-#include "llvm/TargetParser/Host.h"
+#include "llvm/Target/TargetMachine.h"
 #include <algorithm>
 #include <unordered_map>
 
@@ -24,10 +27,10 @@
 static bool generateSectionCode(ParseContext &context, Section *section);
 static llvm::Value *generateExpressionCode(ParseContext &context, Expression *expr);
 static llvm::Value *
-generateIntrinsicCode(ParseContext &context, const std::string &name, const std::vector<Expression *> &args, Type resultType);
+generateIntrinsicCode(ParseContext &context, Intrinsic::Id intrinsic, const std::vector<Expression *> &args, Type resultType);
 static llvm::Function *generateSpecializedFunction(
-	ParseContext &context, Section *section, const std::vector<std::pair<std::string, Expression *>> &paramBindings,
-	const std::vector<Type> &argTypes
+	ParseContext &context, Section *section, std::span<const ParameterBinding> paramBindings,
+	const std::vector<Type> &argTypes, Expansion *expansion
 );
 
 // Get the LLVM type for a given Type
@@ -51,22 +54,21 @@ convertConditionToBool(ParseContext &context, llvm::Value *condValue, Type condT
 static Expression *resolveMacroBinding(ParseContext &context, Expression *expr) {
 	if (!expr || expr->kind != Expression::Kind::Variable || !expr->variable)
 		return expr;
-	auto it = context.macroExpressionBindings.find(expr->variable->name);
-	if (it != context.macroExpressionBindings.end() && it->second != expr)
-		return resolveMacroBinding(context, it->second);
+	Expression *const *binding = context.macroExpressionBindings.find(expr->variable->symbol);
+	if (binding && *binding != expr)
+		return resolveMacroBinding(context, *binding);
 	return expr;
 }
 
-// Resolve the effective type of an expression during codegen.
-// Follows macro expression bindings and pattern parameter types to compute the real type,
-// even for expressions inside non-macro function bodies whose .type was never inferred.
-static Type getEffectiveType(ParseContext &context, Expression *expr) {
-	if (!expr)
-		return {};
+static Type getEffectiveType(ParseContext &context, Expression *expr);
 
+// Compute the effective type of an expression during codegen.
+// Follows macro expression bindings and pattern parameter types to compute the real type.
+// Inside a macro or function body, the inferred types are the ones of the expansion being generated.
+static Type computeEffectiveType(ParseContext &context, Expression *expr) {
 	switch (expr->kind) {
 	case Expression::Kind::Literal:
-		return expr->type; // Literal types are always set by inference
+		return context.typeOf(expr); // Literal types are always set by inference
 
 	case Expression::Kind::Variable: {
 		Expression *resolved = resolveMacroBinding(context, expr);
@@ -74,69 +76,68 @@ static Type getEffectiveType(ParseContext &context, Expression *expr) {
 			return getEffectiveType(context, resolved);
 
 		if (!expr->variable)
-			return expr->type;
-		std::string name = expr->variable->name;
+			return context.typeOf(expr);
 
 		// Check pattern parameter types (monomorphized function: typed parameters)
-		auto paramIt = context.patternParamTypes.find(name);
-		if (paramIt != context.patternParamTypes.end())
-			return paramIt->second;
+		if (const Type *paramType = context.patternParamTypes.find(expr->variable->symbol))
+			return *paramType;
 
-		// Look up in section variables
-		Section *sec = expr->range.line ? expr->range.line->section : nullptr;
-		Variable *var = sec ? sec->findVariable(name) : nullptr;
-		if (var)
+		// The variable in the scope of the reference
+		if (Variable *var = expr->variable->resolved)
 			return var->type;
 
-		return expr->type;
+		return context.typeOf(expr);
 	}
 
 	case Expression::Kind::IntrinsicCall: {
 		// For intrinsics in non-macro function bodies, expr->type may be Undeduced.
 		// Compute the type dynamically from the resolved argument types.
-		if (isArithmeticOperator(expr->intrinsicName)) {
-			if (expr->arguments.size() >= 3) {
-				Type leftType = getEffectiveType(context, expr->arguments[1]);
-				Type rightType = getEffectiveType(context, expr->arguments[2]);
-				return isPointerArithmeticOperator(expr->intrinsicName) ? Type::promoteArithmetic(leftType, rightType)
-																		: Type::promote(leftType, rightType);
-			}
-		}
-		if (isComparisonOperator(expr->intrinsicName) || expr->intrinsicName == "and" || expr->intrinsicName == "or" ||
-			expr->intrinsicName == "not")
+		Intrinsic::Result result = Intrinsic::get(expr->intrinsic).result;
+		if (result == Intrinsic::Result::Bool)
 			return {Type::Kind::Bool};
-		if (expr->intrinsicName == "store" || expr->intrinsicName == "store at" || expr->intrinsicName == "loop while" ||
-			expr->intrinsicName == "if" || expr->intrinsicName == "else if" || expr->intrinsicName == "else" ||
-			expr->intrinsicName == "switch" || expr->intrinsicName == "case")
+		if (result == Intrinsic::Result::Void)
 			return {Type::Kind::Void};
-		if (expr->intrinsicName == "address of" && expr->arguments.size() >= 2)
+
+		switch (expr->intrinsic) {
+		case Intrinsic::Id::Add:
+		case Intrinsic::Id::Subtract:
+		case Intrinsic::Id::Multiply:
+		case Intrinsic::Id::Divide:
+		case Intrinsic::Id::Modulo: {
+			Type leftType = getEffectiveType(context, expr->arguments[1]);
+			Type rightType = getEffectiveType(context, expr->arguments[2]);
+			return Intrinsic::isPointerArithmetic(expr->intrinsic) ? Type::promoteArithmetic(leftType, rightType)
+																   : Type::promote(leftType, rightType);
+		}
+		case Intrinsic::Id::Negate:
+			return getEffectiveType(context, expr->arguments[1]);
+		case Intrinsic::Id::AddressOf:
 			return getEffectiveType(context, expr->arguments[1]).pointed();
-		if (expr->intrinsicName == "dereference" && expr->arguments.size() >= 2)
+		case Intrinsic::Id::Dereference:
 			return getEffectiveType(context, expr->arguments[1]).dereferenced();
-		if (expr->intrinsicName == "load at")
+		case Intrinsic::Id::LoadAt:
 			return {Type::Kind::Integer, 8};
-		if (expr->intrinsicName == "return" && expr->arguments.size() >= 2)
-			return getEffectiveType(context, expr->arguments[1]);
-		if (expr->intrinsicName == "call") {
+		case Intrinsic::Id::Return:
+			if (expr->arguments.size() >= 2)
+				return getEffectiveType(context, expr->arguments[1]);
+			break;
+		case Intrinsic::Id::Call: {
 			// Format: @intrinsic("call", "library", "function", "return type", args...)
-			if (expr->arguments.size() >= 4) {
-				std::string retTypeStr;
-				if (auto *str = std::get_if<std::string>(&expr->arguments[3]->literalValue))
-					retTypeStr = *str;
-				if (!retTypeStr.empty())
-					return Type::fromString(retTypeStr);
-			}
+			std::string retTypeStr;
+			if (auto *str = std::get_if<std::string_view>(&expr->arguments[3]->literalValue))
+				retTypeStr = *str;
+			if (!retTypeStr.empty())
+				return Type::fromString(retTypeStr);
 			return {Type::Kind::Integer, 4};
 		}
-		if (expr->intrinsicName == "construct" || expr->intrinsicName == "property")
-			return expr->type; // Type fully determined during inference
-		if (expr->intrinsicName == "cast" && expr->arguments.size() >= 3) {
+		case Intrinsic::Id::Cast: {
 			// Class cast: type was fully determined during inference
-			if (expr->type.kind == Type::Kind::Class)
-				return expr->type;
+			Type classType = context.typeOf(expr);
+			if (classType.kind == Type::Kind::Class)
+				return classType;
 			// Format: @intrinsic("cast", value, type_string[, bit_size])
 			std::string target;
-			if (auto *str = std::get_if<std::string>(&expr->arguments[2]->literalValue))
+			if (auto *str = std::get_if<std::string_view>(&expr->arguments[2]->literalValue))
 				target = *str;
 			if (target == "integer" || target == "float") {
 				Type::Kind kind = target == "integer" ? Type::Kind::Integer : Type::Kind::Float;
@@ -149,18 +150,37 @@ static Type getEffectiveType(ParseContext &context, Expression *expr) {
 			}
 			if (!target.empty())
 				return Type::fromString(target);
+			break;
 		}
-		return expr->type;
+		default:
+			// construct and property: type fully determined during inference
+			break;
+		}
+		return context.typeOf(expr);
 	}
 
 	case Expression::Kind::PatternCall:
-		return expr->type;
+		return context.typeOf(expr);
 
 	default:
-		return expr->type;
+		return context.typeOf(expr);
 	}
 }
 
+// The effective type of an expression, computed once per expression in the current scope of context.effectiveTypes
+static Type getEffectiveType(ParseContext &context, Expression *expr) {
+	if (!expr)
+		return {};
+	// only variables and intrinsic calls look further than the expression itself
+	if (expr->kind != Expression::Kind::Variable && expr->kind != Expression::Kind::IntrinsicCall)
+		return computeEffectiveType(context, expr);
+	if (const Type *type = context.effectiveTypes.find(expr))
+		return *type;
+	Type type = computeEffectiveType(context, expr);
+	context.effectiveTypes.store(expr, type);
+	return type;
+}
+
 // Create an alloca at function entry (avoids stack growth in loops)
 static llvm::AllocaInst *createEntryAlloca(ParseContext &context, const std::string &name, Type type) {
 	auto &builder = static_cast<llvm::IRBuilder<> &>(*context.llvmBuilder);
@@ -183,16 +203,17 @@ static std::string getPatternFunctionName(Section *section) {
 	return name;
 }
 
-// Generate a monomorphized LLVM function for a pattern definition with specific argument types
+// Generate a monomorphized LLVM function for a pattern definition with specific argument types.
+// expansion holds the types inferred for the body with these argument types
 static llvm::Function *generateSpecializedFunction(
-	ParseContext &context, Section *section, const std::vector<std::pair<std::string, Expression *>> &paramBindings,
-	const std::vector<Type> &argTypes
+	ParseContext &context, Section *section, std::span<const ParameterBinding> paramBindings,
+	const std::vector<Type> &argTypes, Expansion *expansion
 ) {
 	auto &builder = static_cast<llvm::IRBuilder<> &>(*context.llvmBuilder);
 
-	std::vector<std::string> varNames;
-	for (const auto &[name, expr] : paramBindings) {
-		varNames.push_back(name);
+	std::vector<uint32_t> varNames;
+	for (const ParameterBinding &binding : paramBindings) {
+		varNames.push_back(binding.name);
 	}
 
 	// All parameters are opaque pointers
@@ -203,8 +224,10 @@ static llvm::Function *generateSpecializedFunction(
 	if (section->type == SectionType::Effect) {
 		returnType = builder.getVoidTy();
 	} else {
-		auto it = section->instantiations.find(argTypes);
-		assert(it != section->instantiations.end() && "Missing instantiation for arg types");
+		assert(section->definitionTables && "Missing instantiation for arg types");
+		auto &instantiations = section->definitionTables->instantiations;
+		auto it = instantiations.find(argTypes);
+		assert(it != instantiations.end() && "Missing instantiation for arg types");
 		assert(it->second.returnType.isDeduced() && "Return type must be deduced before codegen");
 		returnType = getLLVMType(context, it->second.returnType);
 	}
@@ -221,7 +244,7 @@ static llvm::Function *generateSpecializedFunction(
 
 	size_t argIdx = 0;
 	for (auto &arg : func->args()) {
-		arg.setName(varNames[argIdx++]);
+		arg.setName(context.symbols.text(varNames[argIdx++]));
 	}
 
 	llvm::BasicBlock *entry = llvm::BasicBlock::Create(*context.llvmContext, "entry", func);
@@ -229,20 +252,23 @@ static llvm::Function *generateSpecializedFunction(
 	// Save all codegen state
 	llvm::BasicBlock *savedBlock = builder.GetInsertBlock();
 	llvm::BasicBlock::iterator savedPoint = builder.GetInsertPoint();
-	auto savedPatternBindings = context.patternBindings;
-	auto savedParamTypes = context.patternParamTypes;
+	Expansion *savedExpansion = context.currentExpansion;
 
 	builder.SetInsertPoint(entry);
+	// the body can't see the bindings of macros the call is in
+	context.macroExpressionBindings.pushFrame(true);
+	context.currentExpansion = expansion;
 
 	// Set up bindings: map parameter names to LLVM values and their types
-	context.patternBindings.clear();
-	context.patternParamTypes.clear();
+	context.patternBindings.pushFrame(true);
+	context.patternParamTypes.pushFrame(true);
 	argIdx = 0;
 	for (auto &arg : func->args()) {
-		context.patternBindings[varNames[argIdx]] = &arg;
-		context.patternParamTypes[varNames[argIdx]] = argTypes[argIdx];
+		context.patternBindings.bind(varNames[argIdx], &arg);
+		context.patternParamTypes.bind(varNames[argIdx], argTypes[argIdx]);
 		argIdx++;
 	}
+	context.effectiveTypes.enterScope();
 
 	// Generate function body
 	for (Section *child : section->children) {
@@ -255,8 +281,11 @@ static llvm::Function *generateSpecializedFunction(
 	}
 
 	// Restore all codegen state
-	context.patternBindings = savedPatternBindings;
-	context.patternParamTypes = savedParamTypes;
+	context.effectiveTypes.leaveScope();
+	context.patternBindings.popFrame();
+	context.patternParamTypes.popFrame();
+	context.macroExpressionBindings.popFrame();
+	context.currentExpansion = savedExpansion;
 
 	if (savedBlock) {
 		builder.SetInsertPoint(savedBlock, savedPoint);
@@ -267,9 +296,11 @@ static llvm::Function *generateSpecializedFunction(
 
 // Allocate all variables for a section at its start
 static void allocateSectionVariables(ParseContext &context, Section *section) {
-	for (auto &[name, varDef] : section->variableDefinitions) {
+	if (!section->variableTables)
+		return;
+	for (auto &[name, varDef] : section->variableTables->definitions) {
 		Type varType = {Type::Kind::Integer}; // fallback
-		Variable *var = section->findVariable(name);
+		Variable *var = varDef->resolved;
 		if (var)
 			varType = var->type;
 		if (!varType.isDeduced())
@@ -284,11 +315,8 @@ static llvm::Value *getVariablePointer(ParseContext &context, Expression *expr)
 	if (!expr || expr->kind != Expression::Kind::Variable || !expr->variable)
 		return nullptr;
 
-	std::string varName = expr->variable->name;
-
-	auto bindingIt = context.patternBindings.find(varName);
-	if (bindingIt != context.patternBindings.end())
-		return bindingIt->second;
+	if (llvm::Value *const *binding = context.patternBindings.find(expr->variable->symbol))
+		return *binding;
 
 	VariableReference *varRef = expr->variable;
 	VariableReference *definition = varRef->definition ? varRef->definition : varRef;
@@ -367,7 +395,7 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 			llvm::Type *llvmFloatType = floatType.toLLVM(*context.llvmContext);
 			return llvm::ConstantFP::get(llvmFloatType, *doubleVal);
 		}
-		if (auto *strVal = std::get_if<std::string>(&expr->literalValue)) {
+		if (auto *strVal = std::get_if<std::string_view>(&expr->literalValue)) {
 			// TODO: strings are currently just i8* pointers to constant data.
 			// String operations (concatenation, slicing, etc.) need runtime support.
 			auto it = context.stringConstants.find(*strVal);
@@ -392,16 +420,15 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 
 		if (!expr->variable)
 			return nullptr;
-		std::string varName = expr->variable->name;
+		const std::string &varName = expr->variable->name;
 
 		// Determine this variable's type for loading
 		Type varType = getEffectiveType(context, expr);
 
 		// Class types: return the pointer directly (structs are passed by pointer)
 		if (varType.kind == Type::Kind::Class) {
-			auto bindingIt = context.patternBindings.find(varName);
-			if (bindingIt != context.patternBindings.end())
-				return bindingIt->second;
+			if (llvm::Value *const *binding = context.patternBindings.find(expr->variable->symbol))
+				return *binding;
 			VariableReference *varRef = expr->variable;
 			VariableReference *definition = varRef->definition ? varRef->definition : varRef;
 			if (definition->alloca)
@@ -411,9 +438,8 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 		llvm::Type *loadType = getLLVMType(context, varType);
 
 		// Pattern parameter: load from function argument pointer
-		auto bindingIt = context.patternBindings.find(varName);
-		if (bindingIt != context.patternBindings.end())
-			return builder.CreateAlignedLoad(loadType, bindingIt->second, llvm::Align(8), varName + "_val");
+		if (llvm::Value *const *binding = context.patternBindings.find(expr->variable->symbol))
+			return builder.CreateAlignedLoad(loadType, *binding, llvm::Align(8), varName + "_val");
 
 		// Local variable: load from alloca
 		VariableReference *varRef = expr->variable;
@@ -438,26 +464,15 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 		if (matchedSection->type == SectionType::Class)
 			return nullptr;
 
-		// Sort arguments by source position
-		std::vector<Expression *> sortedArgs = sortArgumentsByPosition(expr->arguments);
-
-		// Build parameter name → argument expression mapping
-		std::vector<std::pair<std::string, Expression *>> paramBindings;
-		size_t argIndex = 0;
-		for (PatternTreeNode *node : expr->patternMatch->nodesPassed) {
-			auto paramIt = node->parameterNames.find(matchedDef);
-			if (paramIt != node->parameterNames.end() && argIndex < sortedArgs.size()) {
-				paramBindings.push_back({paramIt->second, sortedArgs[argIndex++]});
-			}
-		}
+		std::span<const ParameterBinding> paramBindings = expr->parameterBindings;
 
 		if (matchedSection->isMacro) {
 			// Macro: inline the body with expression substitution
-			auto savedMacroBindings = context.macroExpressionBindings;
 			Section *savedBodySection = context.currentBodySection;
 
-			for (const auto &[paramName, argExpr] : paramBindings) {
-				context.macroExpressionBindings[paramName] = argExpr;
+			context.macroExpressionBindings.pushFrame();
+			for (const ParameterBinding &binding : paramBindings) {
+				context.macroExpressionBindings.bind(binding.name, binding.argument);
 			}
 
 			// Only section-type macros (like "if condition:", "loop while condition:")
@@ -470,6 +485,10 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 				context.currentBodySection = bodySection;
 			}
 
+			// the body has the types inferred for this call, the body section opened by the call has those of the caller
+			Expansion *savedExpansion = context.currentExpansion;
+			context.currentExpansion = context.calleeOf(expr);
+			context.effectiveTypes.enterScope();
 			llvm::Value *result = nullptr;
 			for (Section *child : matchedSection->children) {
 				for (CodeLine *line : child->codeLines) {
@@ -477,9 +496,14 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 						result = generateExpressionCode(context, line->expression);
 				}
 			}
+			context.effectiveTypes.leaveScope();
+			context.currentExpansion = savedExpansion;
 
 			if (bodySection) {
+				// the body section sees the bindings of this call, so its types can differ from those of the caller
+				context.effectiveTypes.enterScope();
 				generateSectionCode(context, bodySection);
+				context.effectiveTypes.leaveScope();
 				if (bodySection->exitBlock) {
 					if (!builder.GetInsertBlock()->getTerminator()) {
 						llvm::BasicBlock *target =
@@ -490,7 +514,7 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 				}
 			}
 
-			context.macroExpressionBindings = savedMacroBindings;
+			context.macroExpressionBindings.popFrame();
 			context.currentBodySection = savedBodySection;
 			return result;
 		}
@@ -498,22 +522,23 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 		// Non-macro pattern: monomorphized function call.
 		// Compute argument types at this call site for specialization.
 		std::vector<Type> argTypes;
-		for (const auto &[paramName, argExpr] : paramBindings) {
-			argTypes.push_back(getEffectiveType(context, argExpr));
+		for (const ParameterBinding &binding : paramBindings) {
+			argTypes.push_back(getEffectiveType(context, binding.argument));
 		}
 
 		// Look up or generate the specialized function
-		Instantiation &inst = matchedSection->instantiations[argTypes];
+		Instantiation &inst = matchedSection->getDefinitionTables(context.arena).instantiations[argTypes];
 		if (!inst.llvmFunction) {
-			inst.llvmFunction = generateSpecializedFunction(context, matchedSection, paramBindings, argTypes);
+			inst.llvmFunction =
+				generateSpecializedFunction(context, matchedSection, paramBindings, argTypes, context.calleeOf(expr));
 		}
 		llvm::Function *func = inst.llvmFunction;
 
 		// Build call arguments: pass variable pointers or temp allocas
 		std::vector<llvm::Value *> args;
 		for (size_t i = 0; i < paramBindings.size(); i++) {
-			Expression *argExpr = paramBindings[i].second;
-			llvm::Value *ptr = getVariablePointer(context, argExpr);
+			Expression *argExpr = paramBindings[i].argument;
+			llvm::Value *ptr = paramBindings[i].isVariable ? getVariablePointer(context, argExpr) : nullptr;
 			if (ptr) {
 				args.push_back(ptr);
 			} else {
@@ -531,7 +556,7 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 
 	case Expression::Kind::IntrinsicCall: {
 		std::vector<Expression *> args(expr->arguments.begin() + 1, expr->arguments.end());
-		return generateIntrinsicCode(context, expr->intrinsicName, args, getEffectiveType(context, expr));
+		return generateIntrinsicCode(context, expr->intrinsic, args, getEffectiveType(context, expr));
 	}
 
 	case Expression::Kind::Pending:
@@ -545,8 +570,8 @@ static llvm::Value *generateExpressionCode(ParseContext &context, Expression *ex
 // Helper to extract string literal from expression
 static std::string getStringLiteral(Expression *expr) {
 	if (expr && expr->kind == Expression::Kind::Literal) {
-		if (auto *str = std::get_if<std::string>(&expr->literalValue))
-			return *str;
+		if (auto *str = std::get_if<std::string_view>(&expr->literalValue))
+			return std::string(*str);
 	}
 	return "";
 }
@@ -554,28 +579,21 @@ static std::string getStringLiteral(Expression *expr) {
 // Generate code for an intrinsic call.
 // All type decisions use getEffectiveType to resolve through macro/pattern bindings.
 static llvm::Value *
-generateIntrinsicCode(ParseContext &context, const std::string &name, const std::vector<Expression *> &args, Type resultType) {
+generateIntrinsicCode(ParseContext &context, Intrinsic::Id intrinsic, const std::vector<Expression *> &args, Type resultType) {
 	auto &builder = static_cast<llvm::IRBuilder<> &>(*context.llvmBuilder);
 
-	if (name == "store") {
+	switch (intrinsic) {
+	case Intrinsic::Id::Store: {
 		Expression *destExpr = resolveMacroBinding(context, args[0]);
 		Type valType = getEffectiveType(context, args[1]);
 
-		if (destExpr->kind == Expression::Kind::IntrinsicCall && destExpr->intrinsicName == "property") {
+		if (destExpr->kind == Expression::Kind::IntrinsicCall && destExpr->intrinsic == Intrinsic::Id::Property) {
 			// Storing to a class field: generate GEP + store
 			Expression *instExpr = resolveMacroBinding(context, destExpr->arguments[1]);
 			Type instType = getEffectiveType(context, instExpr);
 			ClassDefinition *classDef = instType.classDefinition;
 			Expression *propExpr = resolveMacroBinding(context, destExpr->arguments[2]);
-			std::string fieldName = getStringLiteral(propExpr);
-
-			int fieldIdx = -1;
-			for (size_t i = 0; i < classDef->fields.size(); i++) {
-				if (classDef->fields[i].name == fieldName) {
-					fieldIdx = i;
-					break;
-				}
-			}
+			int fieldIdx = classDef->fieldIndex(propExpr->symbol);
 
 			llvm::Value *instPtr = getVariablePointer(context, instExpr);
 			llvm::Type *structType = getLLVMType(context, instType);
@@ -604,7 +622,11 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 	}
 
 	// Arithmetic intrinsics
-	if (isArithmeticOperator(name)) {
+	case Intrinsic::Id::Add:
+	case Intrinsic::Id::Subtract:
+	case Intrinsic::Id::Multiply:
+	case Intrinsic::Id::Divide:
+	case Intrinsic::Id::Modulo: {
 		if (args.size() >= 2) {
 			llvm::Value *left = generateExpressionCode(context, args[0]);
 			llvm::Value *right = generateExpressionCode(context, args[1]);
@@ -612,12 +634,12 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 			Type rightType = getEffectiveType(context, args[1]);
 
 			// Pointer arithmetic: ptr +/- integer → GEP
-			if (isPointerArithmeticOperator(name) && (leftType.isPointer() || rightType.isPointer())) {
+			if (Intrinsic::isPointerArithmetic(intrinsic) && (leftType.isPointer() || rightType.isPointer())) {
 				llvm::Value *ptrVal = leftType.isPointer() ? left : right;
 				llvm::Value *indexVal = leftType.isPointer() ? right : left;
 				Type ptrType = leftType.isPointer() ? leftType : rightType;
 				llvm::Type *elemType = ptrType.dereferenced().toLLVM(*context.llvmContext);
-				if (name == "subtract" && leftType.isPointer())
+				if (intrinsic == Intrinsic::Id::Subtract && leftType.isPointer())
 					indexVal = builder.CreateNeg(indexVal, "neg_idx");
 				return builder.CreateGEP(elemType, ptrVal, indexVal, "ptr_arith");
 			}
@@ -627,28 +649,18 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 			left = ensureType(context, left, leftType, promoted);
 			right = ensureType(context, right, rightType, promoted);
 
-			if (promoted.kind == Type::Kind::Float) {
-				if (name == "add")
-					return builder.CreateFAdd(left, right, "fadd");
-				if (name == "subtract")
-					return builder.CreateFSub(left, right, "fsub");
-				if (name == "multiply")
-					return builder.CreateFMul(left, right, "fmul");
-				if (name == "divide")
-					return builder.CreateFDiv(left, right, "fdiv");
-				if (name == "modulo")
-					return builder.CreateFRem(left, right, "fmod");
-			} else {
-				if (name == "add")
-					return builder.CreateAdd(left, right, "add");
-				if (name == "subtract")
-					return builder.CreateSub(left, right, "sub");
-				if (name == "multiply")
-					return builder.CreateMul(left, right, "mul");
-				if (name == "divide")
-					return builder.CreateSDiv(left, right, "div");
-				if (name == "modulo")
-					return builder.CreateSRem(left, right, "mod");
+			bool isFloat = promoted.kind == Type::Kind::Float;
+			switch (intrinsic) {
+			case Intrinsic::Id::Add:
+				return isFloat ? builder.CreateFAdd(left, right, "fadd") : builder.CreateAdd(left, right, "add");
+			case Intrinsic::Id::Subtract:
+				return isFloat ? builder.CreateFSub(left, right, "fsub") : builder.CreateSub(left, right, "sub");
+			case Intrinsic::Id::Multiply:
+				return isFloat ? builder.CreateFMul(left, right, "fmul") : builder.CreateMul(left, right, "mul");
+			case Intrinsic::Id::Divide:
+				return isFloat ? builder.CreateFDiv(left, right, "fdiv") : builder.CreateSDiv(left, right, "div");
+			default:
+				return isFloat ? builder.CreateFRem(left, right, "fmod") : builder.CreateSRem(left, right, "mod");
 			}
 		}
 		// Arithmetic operator called with insufficient arguments
@@ -657,7 +669,12 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 	}
 
 	// Comparison intrinsics
-	if (isComparisonOperator(name)) {
+	case Intrinsic::Id::LessThan:
+	case Intrinsic::Id::LessThanOrEqual:
+	case Intrinsic::Id::GreaterThan:
+	case Intrinsic::Id::GreaterThanOrEqual:
+	case Intrinsic::Id::Equal:
+	case Intrinsic::Id::NotEqual: {
 		if (args.size() >= 2) {
 			llvm::Value *left = generateExpressionCode(context, args[0]);
 			llvm::Value *right = generateExpressionCode(context, args[1]);
@@ -668,33 +685,27 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 			left = ensureType(context, left, leftType, promoted);
 			right = ensureType(context, right, rightType, promoted);
 
+			bool isFloat = promoted.kind == Type::Kind::Float;
 			llvm::Value *cmp;
-			if (promoted.kind == Type::Kind::Float) {
-				if (name == "less than")
-					cmp = builder.CreateFCmpOLT(left, right, "flt");
-				else if (name == "less than or equal")
-					cmp = builder.CreateFCmpOLE(left, right, "fle");
-				else if (name == "greater than")
-					cmp = builder.CreateFCmpOGT(left, right, "fgt");
-				else if (name == "greater than or equal")
-					cmp = builder.CreateFCmpOGE(left, right, "fge");
-				else if (name == "equal")
-					cmp = builder.CreateFCmpOEQ(left, right, "feq");
-				else
-					cmp = builder.CreateFCmpONE(left, right, "fne");
-			} else {
-				if (name == "less than")
-					cmp = builder.CreateICmpSLT(left, right, "lt");
-				else if (name == "less than or equal")
-					cmp = builder.CreateICmpSLE(left, right, "le");
-				else if (name == "greater than")
-					cmp = builder.CreateICmpSGT(left, right, "gt");
-				else if (name == "greater than or equal")
-					cmp = builder.CreateICmpSGE(left, right, "ge");
-				else if (name == "equal")
-					cmp = builder.CreateICmpEQ(left, right, "eq");
-				else
-					cmp = builder.CreateICmpNE(left, right, "ne");
+			switch (intrinsic) {
+			case Intrinsic::Id::LessThan:
+				cmp = isFloat ? builder.CreateFCmpOLT(left, right, "flt") : builder.CreateICmpSLT(left, right, "lt");
+				break;
+			case Intrinsic::Id::LessThanOrEqual:
+				cmp = isFloat ? builder.CreateFCmpOLE(left, right, "fle") : builder.CreateICmpSLE(left, right, "le");
+				break;
+			case Intrinsic::Id::GreaterThan:
+				cmp = isFloat ? builder.CreateFCmpOGT(left, right, "fgt") : builder.CreateICmpSGT(left, right, "gt");
+				break;
+			case Intrinsic::Id::GreaterThanOrEqual:
+				cmp = isFloat ? builder.CreateFCmpOGE(left, right, "fge") : builder.CreateICmpSGE(left, right, "ge");
+				break;
+			case Intrinsic::Id::Equal:
+				cmp = isFloat ? builder.CreateFCmpOEQ(left, right, "feq") : builder.CreateICmpEQ(left, right, "eq");
+				break;
+			default:
+				cmp = isFloat ? builder.CreateFCmpONE(left, right, "fne") : builder.CreateICmpNE(left, right, "ne");
+				break;
 			}
 
 			assert(resultType.isDeduced() && "Comparison result type must be deduced before codegen");
@@ -708,7 +719,8 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 	}
 
 	// Logical operators
-	if (name == "and" || name == "or") {
+	case Intrinsic::Id::And:
+	case Intrinsic::Id::Or: {
 		if (args.size() >= 2) {
 			llvm::Value *left = generateExpressionCode(context, args[0]);
 			llvm::Value *right = generateExpressionCode(context, args[1]);
@@ -718,7 +730,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 			left = convertConditionToBool(context, left, leftType, "tobool");
 			right = convertConditionToBool(context, right, rightType, "tobool");
 
-			if (name == "and")
+			if (intrinsic == Intrinsic::Id::And)
 				return builder.CreateAnd(left, right, "and");
 			else
 				return builder.CreateOr(left, right, "or");
@@ -726,7 +738,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return builder.getFalse();
 	}
 
-	if (name == "not") {
+	case Intrinsic::Id::Not: {
 		if (args.size() >= 1) {
 			llvm::Value *val = generateExpressionCode(context, args[0]);
 			Type valType = getEffectiveType(context, args[0]);
@@ -738,8 +750,16 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return builder.getFalse();
 	}
 
+	case Intrinsic::Id::Negate: {
+		llvm::Value *val = generateExpressionCode(context, args[0]);
+		Type valType = getEffectiveType(context, args[0]);
+		if (valType.kind == Type::Kind::Float)
+			return builder.CreateFNeg(val, "fneg");
+		return builder.CreateNeg(val, "neg");
+	}
+
 	// Pointer intrinsics
-	if (name == "address of") {
+	case Intrinsic::Id::AddressOf: {
 		if (args.size() >= 1) {
 			llvm::Value *ptr = getVariablePointer(context, args[0]);
 			assert(ptr && "address of requires a variable");
@@ -748,7 +768,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "dereference") {
+	case Intrinsic::Id::Dereference: {
 		if (args.size() >= 1) {
 			llvm::Value *ptrVal = generateExpressionCode(context, args[0]);
 			Type ptrType = getEffectiveType(context, args[0]);
@@ -760,7 +780,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 	}
 
 	// Array/pointer intrinsics
-	if (name == "store at") {
+	case Intrinsic::Id::StoreAt: {
 		if (args.size() >= 3) {
 			llvm::Value *ptr = generateExpressionCode(context, args[0]);
 			llvm::Value *index = generateExpressionCode(context, args[1]);
@@ -774,7 +794,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "load at") {
+	case Intrinsic::Id::LoadAt: {
 		if (args.size() >= 2) {
 			llvm::Value *ptr = generateExpressionCode(context, args[0]);
 			llvm::Value *index = generateExpressionCode(context, args[1]);
@@ -791,7 +811,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "loop while") {
+	case Intrinsic::Id::LoopWhile: {
 		if (args.empty()) {
 			context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "loop while requires a condition", Range()));
 			return nullptr;
@@ -824,7 +844,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "if") {
+	case Intrinsic::Id::If: {
 		if (args.empty()) {
 			context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "if requires a condition", Range()));
 			return nullptr;
@@ -853,9 +873,11 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "else" || name == "else if") {
+	case Intrinsic::Id::Else:
+	case Intrinsic::Id::ElseIf: {
 		Section *bodySection = context.currentBodySection;
 		if (!bodySection) {
+			std::string name(Intrinsic::get(intrinsic).name);
 			context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, name + " requires a body section", Range()));
 			return nullptr;
 		}
@@ -880,7 +902,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 			pred->getTerminator()->replaceUsesOfWith(currentBlock, newExitBlock);
 		}
 
-		if (name == "else if") {
+		if (intrinsic == Intrinsic::Id::ElseIf) {
 			// Evaluate condition, branch to elif_then or newExitBlock
 			if (args.empty()) {
 				context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "else if requires a condition", Range()));
@@ -903,7 +925,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "switch") {
+	case Intrinsic::Id::Switch: {
 		if (args.empty()) {
 			context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "switch requires a value", Range()));
 			return nullptr;
@@ -940,7 +962,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "case") {
+	case Intrinsic::Id::Case: {
 		if (args.empty()) {
 			context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "case requires a value", Range()));
 			return nullptr;
@@ -971,7 +993,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "return") {
+	case Intrinsic::Id::Return: {
 		if (args.size() >= 1) {
 			llvm::Value *returnValue = generateExpressionCode(context, args[0]);
 			builder.CreateRet(returnValue);
@@ -979,7 +1001,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "call") {
+	case Intrinsic::Id::Call: {
 		// Format: args[0]="library", args[1]="function", args[2]="return type", args[3+]=actual args
 		if (args.size() >= 3) {
 			std::string library = getStringLiteral(args[0]);
@@ -996,7 +1018,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 			std::vector<llvm::Value *> callArgs;
 			for (size_t i = 3; i < args.size(); ++i) {
 				if (args[i]->kind == Expression::Kind::Literal) {
-					if (auto *str = std::get_if<std::string>(&args[i]->literalValue)) {
+					if (auto *str = std::get_if<std::string_view>(&args[i]->literalValue)) {
 						std::string globalName = ".str." + std::to_string(context.stringConstants.size());
 						llvm::Constant *strConst = llvm::ConstantDataArray::getString(*context.llvmContext, *str, true);
 						llvm::GlobalVariable *strGlobal = new llvm::GlobalVariable(
@@ -1029,7 +1051,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "cast") {
+	case Intrinsic::Id::Cast: {
 		// Format: args[0]=value, args[1]=type_string_or_type_ref[, args[2]=bit_size]
 		if (args.size() >= 2) {
 			// Class cast: reinterpret as pointer to the class struct
@@ -1093,7 +1115,7 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return nullptr;
 	}
 
-	if (name == "construct") {
+	case Intrinsic::Id::Construct: {
 		// Format: args[0]=type_pattern, args[1+]=field values
 		ClassDefinition *classDef = resultType.classDefinition;
 		ClassInstantiation &inst = classDef->instantiations[resultType.classInstIndex];
@@ -1114,15 +1136,14 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		return alloca;
 	}
 
-	if (name == "property") {
+	case Intrinsic::Id::Property: {
 		// Format: args[0]=instance, args[1]=fieldname (string literal from {word:} capture)
 		Expression *instExpr = resolveMacroBinding(context, args[0]);
 		Type instType = getEffectiveType(context, instExpr);
 		ClassDefinition *classDef = instType.classDefinition;
 
-		// Get field name from string literal
+		// The field name is a string literal
 		Expression *propExpr = resolveMacroBinding(context, args[1]);
-		std::string fieldName = getStringLiteral(propExpr);
 
 		if (!classDef) {
 			context.diagnostics.push_back(Diagnostic(
@@ -1131,18 +1152,11 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 			return nullptr;
 		}
 
-		// Find field index
-		int fieldIdx = -1;
-		for (size_t i = 0; i < classDef->fields.size(); i++) {
-			if (classDef->fields[i].name == fieldName) {
-				fieldIdx = i;
-				break;
-			}
-		}
-
+		int fieldIdx = classDef->fieldIndex(propExpr->symbol);
 		if (fieldIdx == -1) {
 			context.diagnostics.push_back(Diagnostic(
-				Diagnostic::Level::Error, instType.toString() + " doesn't have property \"" + fieldName + "\"", args[0]->range
+				Diagnostic::Level::Error,
+				instType.toString() + " doesn't have property \"" + getStringLiteral(propExpr) + "\"", args[0]->range
 			));
 			return nullptr;
 		}
@@ -1152,11 +1166,14 @@ generateIntrinsicCode(ParseContext &context, const std::string &name, const std:
 		llvm::Type *structType = getLLVMType(context, instType);
 		llvm::Value *fieldPtr = builder.CreateStructGEP(structType, instPtr, fieldIdx, "field_ptr");
 		Type fieldType = classDef->instantiations[instType.classInstIndex].fieldTypes[fieldIdx];
+		const std::string &fieldName = classDef->fields[fieldIdx].name;
 		return builder.CreateAlignedLoad(getLLVMType(context, fieldType), fieldPtr, llvm::Align(8), fieldName + "_val");
 	}
 
-	context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "Unknown intrinsic: " + name, Range()));
-	return nullptr;
+	default:
+		// unknown intrinsics are reported when parsing
+		return nullptr;
+	}
 }
 
 // Generate code for a section (process pattern references)
@@ -1175,7 +1192,20 @@ bool generateCode(ParseContext &context) {
 	context.llvmContext = new llvm::LLVMContext();
 	context.llvmModule = new llvm::Module("dynlex_module", *context.llvmContext);
 	context.llvmBuilder = new llvm::IRBuilder<>(*context.llvmContext);
-	context.llvmModule->setTargetTriple(llvm::sys::getDefaultTargetTriple());
+
+	// the optimizations need the target machine to know which instructions the CPU has
+	llvm::InitializeNativeTarget();
+	llvm::InitializeNativeTargetAsmPrinter();
+	llvm::InitializeNativeTargetAsmParser();
+	resolveTargetCpu(context);
+	std::string targetError;
+	std::unique_ptr<llvm::TargetMachine> targetMachine = createTargetMachine(context, targetError);
+	if (!targetMachine) {
+		context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, targetError, Range()));
+		return false;
+	}
+	context.llvmModule->setTargetTriple(targetMachine->getTargetTriple().str());
+	context.llvmModule->setDataLayout(targetMachine->createDataLayout());
 
 	auto &builder = static_cast<llvm::IRBuilder<> &>(*context.llvmBuilder);
 
@@ -1192,6 +1222,7 @@ bool generateCode(ParseContext &context) {
 		return false;
 
 	builder.CreateRet(builder.getInt32(0));
+	addTargetAttributes(context);
 
 	// Verify
 	std::string error;
@@ -1211,7 +1242,7 @@ bool generateCode(ParseContext &context) {
 		llvm::CGSCCAnalysisManager cgam;
 		llvm::ModuleAnalysisManager mam;
 
-		llvm::PassBuilder pb;
+		llvm::PassBuilder pb(targetMachine.get());
 		pb.registerModuleAnalyses(mam);
 		pb.registerCGSCCAnalyses(cgam);
 		pb.registerFunctionAnalyses(fam);
@@ -1252,6 +1283,9 @@ bool generateCode(ParseContext &context) {
 			return false;
 		}
 		context.llvmModule->print(out, nullptr);
+	} else if (context.options.run) {
+		if (!runInProcess(context))
+			return false;
 	} else {
 		if (!emitNativeExecutable(context))
 			return false;
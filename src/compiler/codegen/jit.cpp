@@ -0,0 +1,82 @@
+#include "jit.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// the file dlopen loads for a library which the linker would find with -l
+static std::string sharedLibraryName(const std::string &library) {
+#ifdef __APPLE__
+	return "lib" + library + ".dylib";
+#else
+	return "lib" + library + ".so";
+#endif
+}
+
+static bool addError(ParseContext &context, const std::string &message, llvm::Error error) {
+	context.diagnostics.push_back(
+		Diagnostic(Diagnostic::Level::Error, message + ": " + llvm::toString(std::move(error)), Range())
+	);
+	return false;
+}
+
+bool runInProcess(ParseContext &context) {
+	// the JIT generates code for the CPU the module was optimized for
+	llvm::orc::JITTargetMachineBuilder targetMachineBuilder(llvm::Triple(context.llvmModule->getTargetTriple()));
+	targetMachineBuilder.setCPU(context.options.targetCpu);
+	targetMachineBuilder.addFeatures(llvm::SubtargetFeatures(context.options.targetFeatures).getFeatures());
+	llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>> jit =
+		llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(targetMachineBuilder)).create();
+	if (!jit)
+		return addError(context, "Failed to create JIT", jit.takeError());
+	llvm::orc::JITDylib &mainLibrary = (*jit)->getMainJITDylib();
+	char globalPrefix = (*jit)->getDataLayout().getGlobalPrefix();
+
+	// the libraries an executable would be linked with are opened instead. some can't be, like glibc's libm.so which is
+	// a linker script. that's only an error if their symbols aren't in the process either
+	std::vector<std::string> libraryErrors;
+	for (const std::string &library : context.requiredLibraries) {
+		std::string fileName = sharedLibraryName(library);
+		auto librarySymbols = llvm::orc::DynamicLibrarySearchGenerator::Load(fileName.c_str(), globalPrefix);
+		if (librarySymbols)
+			mainLibrary.addGenerator(std::move(*librarySymbols));
+		else
+			libraryErrors.push_back("Failed to load library " + fileName + ": " + llvm::toString(librarySymbols.takeError()));
+	}
+	// libc and everything else the compiler is linked against
+	auto processSymbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(globalPrefix);
+	if (!processSymbols)
+		return addError(context, "Failed to look up the symbols of the process", processSymbols.takeError());
+	mainLibrary.addGenerator(std::move(*processSymbols));
+
+	context.llvmModule->setDataLayout((*jit)->getDataLayout());
+	llvm::orc::ThreadSafeModule module(
+		std::unique_ptr<llvm::Module>(context.llvmModule), std::unique_ptr<llvm::LLVMContext>(context.llvmContext)
+	);
+	context.llvmModule = nullptr;
+	context.llvmContext = nullptr;
+	if (llvm::Error error = (*jit)->addIRModule(std::move(module)))
+		return addError(context, "Failed to add the module to the JIT", std::move(error));
+
+	llvm::Expected<llvm::orc::ExecutorAddr> mainAddress = (*jit)->lookup("main");
+	if (!mainAddress) {
+		for (const std::string &libraryError : libraryErrors)
+			context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, libraryError, Range()));
+		return addError(context, "Failed to compile main", mainAddress.takeError());
+	}
+	if (llvm::Error error = (*jit)->initialize(mainLibrary))
+		return addError(context, "Failed to initialize the program", std::move(error));
+	auto *mainFunction = mainAddress->toPtr<int (*)()>();
+	context.exitCode = mainFunction();
+	// the program shares stdout with the compiler, so its output comes before the diagnostics
+	std::fflush(stdout);
+	if (llvm::Error error = (*jit)->deinitialize(mainLibrary))
+		return addError(context, "Failed to deinitialize the program", std::move(error));
+	return true;
+}
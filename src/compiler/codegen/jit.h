@@ -0,0 +1,6 @@
+#pragma once
+#include "parseContext.h"
+
+// JIT compile the LLVM module and call its main function in this process. The module is moved into the JIT.
+// Returns true if main was called, with its result in context.exitCode. Otherwise errors are added to context.diagnostics
+bool runInProcess(ParseContext &context);
@@ -0,0 +1,147 @@
+#include "linker.h"
+
+#if defined(DYNLEX_LLD) && defined(__linux__)
+#include "lld/Common/Driver.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/TargetParser/Triple.h"
+#include <cstdlib>
+#include <filesystem>
+#include <sys/mman.h>
+#include <unistd.h>
+
+LLD_HAS_DRIVER(elf)
+
+// the dynamic linker of glibc, or an empty string if it isn't known for the architecture
+static std::string dynamicLinker(const llvm::Triple &triple) {
+	switch (triple.getArch()) {
+	case llvm::Triple::x86_64:
+		return "/lib64/ld-linux-x86-64.so.2";
+	case llvm::Triple::aarch64:
+		return "/lib/ld-linux-aarch64.so.1";
+	default:
+		return {};
+	}
+}
+
+// the first of the directories containing the file, or an empty path if none does
+static std::filesystem::path findDirectory(const std::vector<std::filesystem::path> &directories, const char *fileName) {
+	for (const std::filesystem::path &directory : directories) {
+		if (std::filesystem::exists(directory / fileName))
+			return directory;
+	}
+	return {};
+}
+
+// gcc's runtime (crtbeginS.o and libgcc) is in a directory per gcc version. the newest is used, like cc does
+static std::filesystem::path findGccDirectory(const std::string &multiarch) {
+	std::filesystem::path newest;
+	unsigned long newestVersion = 0;
+	std::error_code error;
+	for (const std::filesystem::directory_entry &entry :
+		 std::filesystem::directory_iterator("/usr/lib/gcc/" + multiarch, error)) {
+		unsigned long version = std::strtoul(entry.path().filename().c_str(), nullptr, 10);
+		if (version >= newestVersion && std::filesystem::exists(entry.path() / "crtbeginS.o")) {
+			newest = entry.path();
+			newestVersion = version;
+		}
+	}
+	return newest;
+}
+
+// an anonymous file in memory with the contents, which lld opens through /proc. returns -1 on failure
+static int createMemoryFile(const llvm::SmallString<0> &contents) {
+	int fileDescriptor = memfd_create("dynlex.o", MFD_CLOEXEC);
+	if (fileDescriptor < 0)
+		return -1;
+	size_t written = 0;
+	while (written < contents.size()) {
+		ssize_t count = write(fileDescriptor, contents.data() + written, contents.size() - written);
+		if (count <= 0) {
+			close(fileDescriptor);
+			return -1;
+		}
+		written += count;
+	}
+	return fileDescriptor;
+}
+
+bool linkInProcess(
+	const ParseContext &context, const std::string &targetTriple, const std::vector<llvm::SmallString<0>> &objects,
+	const std::string &outputPath, std::string &error
+) {
+	// the C runtime is found where Debian and Ubuntu install it. elsewhere, cc knows where it is
+	llvm::Triple triple(targetTriple);
+	std::string loader = dynamicLinker(triple);
+	if (loader.empty())
+		return false;
+	std::string multiarch = triple.getArchName().str() + "-linux-gnu";
+	std::filesystem::path runtimeDirectory =
+		findDirectory({"/usr/lib/" + multiarch, "/usr/lib64", "/usr/lib"}, "Scrt1.o");
+	std::filesystem::path gccDirectory = findGccDirectory(multiarch);
+	if (runtimeDirectory.empty() || gccDirectory.empty())
+		return false;
+
+	std::vector<int> fileDescriptors;
+	for (const llvm::SmallString<0> &object : objects) {
+		int fileDescriptor = createMemoryFile(object);
+		if (fileDescriptor < 0)
+			break;
+		fileDescriptors.push_back(fileDescriptor);
+	}
+
+	// the arguments cc passes to the linker for a position independent executable
+	std::vector<std::string> arguments = {
+		"ld.lld",
+		"--eh-frame-hdr",
+		"--hash-style=gnu",
+		"--build-id",
+		"-pie",
+		"-dynamic-linker",
+		loader,
+		"-o",
+		outputPath,
+		(runtimeDirectory / "Scrt1.o").string(),
+		(runtimeDirectory / "crti.o").string(),
+		(gccDirectory / "crtbeginS.o").string(),
+		"-L" + gccDirectory.string(),
+		"-L" + runtimeDirectory.string(),
+		"-L/lib/" + multiarch,
+	};
+	for (int fileDescriptor : fileDescriptors)
+		arguments.push_back("/proc/self/fd/" + std::to_string(fileDescriptor));
+	for (const std::string &library : context.requiredLibraries)
+		arguments.push_back("-l" + library);
+	for (const char *argument : {"-lgcc", "--push-state", "--as-needed", "-lgcc_s", "--pop-state", "-lc", "-lgcc",
+								"--push-state", "--as-needed", "-lgcc_s", "--pop-state"})
+		arguments.push_back(argument);
+	arguments.push_back((gccDirectory / "crtendS.o").string());
+	arguments.push_back((runtimeDirectory / "crtn.o").string());
+
+	std::vector<const char *> argumentPointers;
+	for (const std::string &argument : arguments)
+		argumentPointers.push_back(argument.c_str());
+
+	// lld only runs if every object is in a memory file. otherwise the system linker links them
+	bool ran = fileDescriptors.size() == objects.size();
+	if (ran) {
+		std::string messages;
+		llvm::raw_string_ostream messageStream(messages);
+		lld::Result result = lld::lldMain(argumentPointers, messageStream, messageStream, {{lld::Gnu, &lld::elf::link}});
+		if (result.retCode != 0) {
+			messageStream.flush();
+			while (!messages.empty() && messages.back() == '\n')
+				messages.pop_back();
+			error = messages.empty() ? "lld failed with exit code " + std::to_string(result.retCode) : messages;
+		}
+	}
+	for (int fileDescriptor : fileDescriptors)
+		close(fileDescriptor);
+	return ran;
+}
+#else
+bool linkInProcess(
+	const ParseContext &, const std::string &, const std::vector<llvm::SmallString<0>> &, const std::string &, std::string &
+) {
+	return false;
+}
+#endif
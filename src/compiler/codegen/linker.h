@@ -0,0 +1,14 @@
+#pragma once
+#include "parseContext.h"
+#include "llvm/ADT/SmallString.h"
+#include <string>
+#include <vector>
+
+// Link the object files in memory into an executable with the lld built into dynlex, without writing them to disk or
+// starting other processes. Returns false if lld can't run, like when dynlex is built without lld or the C runtime isn't
+// found where it's looked for, so the system linker can link them instead. If lld ran and failed, error holds its
+// messages.
+bool linkInProcess(
+	const ParseContext &context, const std::string &targetTriple, const std::vector<llvm::SmallString<0>> &objects,
+	const std::string &outputPath, std::string &error
+);
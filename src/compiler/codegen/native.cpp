@@ -1,46 +1,79 @@
 #include "native.h"
+#include "linker.h"
+#include "parallelFor.h"
+#include "target.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
-#include "llvm/MC/TargetRegistry.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/FileSystem.h"
-#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
-#include "llvm/Target/TargetOptions.h"
-#include "llvm/TargetParser/Host.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include <algorithm>
 #include <cstdlib>
 #include <filesystem>
+#include <memory>
 
-bool emitNativeExecutable(ParseContext &context) {
-	// Initialize native target
-	llvm::InitializeNativeTarget();
-	llvm::InitializeNativeTargetAsmPrinter();
-	llvm::InitializeNativeTargetAsmParser();
+// Emit the module as object file in memory. Returns the error message, or an empty string on success.
+static std::string emitObjectFile(llvm::TargetMachine &targetMachine, llvm::Module &module, llvm::SmallString<0> &object) {
+	llvm::raw_svector_ostream dest(object);
+	llvm::legacy::PassManager passManager;
+	if (targetMachine.addPassesToEmitFile(passManager, dest, nullptr, llvm::CodeGenFileType::ObjectFile))
+		return "Target machine cannot emit object file";
 
-	std::string targetTriple = llvm::sys::getDefaultTargetTriple();
-	context.llvmModule->setTargetTriple(targetTriple);
+	passManager.run(module);
+	return {};
+}
 
-	// Find target
-	std::string error;
-	const llvm::Target *target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
-	if (!target) {
-		context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "Failed to get target: " + error, Range()));
-		return false;
-	}
+// the number of parts to split the module into, one per worker. a part should take longer to compile than passing it to
+// its worker
+static size_t partitionCount(const ParseContext &context) {
+	constexpr size_t minimumInstructionsPerWorker = 20000;
+	size_t instructionCount = 0;
+	for (const llvm::Function &function : *context.llvmModule)
+		instructionCount += function.getInstructionCount();
+	return std::min<size_t>(context.jobCount(), instructionCount / minimumInstructionsPerWorker);
+}
 
-	// Create target machine
-	llvm::TargetOptions options;
-	auto targetMachine = target->createTargetMachine(
-		targetTriple, "generic", "", options, llvm::Reloc::PIC_, std::nullopt,
-		context.options.optimizationLevel >= 2 ? llvm::CodeGenOptLevel::Aggressive : llvm::CodeGenOptLevel::Default
-	);
+// Split the module into parts and emit each part as object file on its own thread. Modules can't be shared between
+// threads, so each part is passed to its worker as bitcode and read into the LLVM context of the worker.
+// Returns the error messages of the parts, which are empty on success.
+static std::vector<std::string> emitObjectFiles(const ParseContext &context, std::vector<llvm::SmallString<0>> &objects) {
+	std::vector<llvm::SmallString<0>> partitions;
+	llvm::SplitModule(*context.llvmModule, objects.size(), [&](std::unique_ptr<llvm::Module> partition) {
+		llvm::raw_svector_ostream stream(partitions.emplace_back());
+		llvm::WriteBitcodeToFile(*partition, stream);
+	});
+
+	std::vector<std::string> errors(partitions.size());
+	parallelFor(partitions.size(), partitions.size(), [&](size_t, size_t index) {
+		llvm::LLVMContext llvmContext;
+		llvm::MemoryBufferRef bitcode(llvm::StringRef(partitions[index].data(), partitions[index].size()), "partition");
+		llvm::Expected<std::unique_ptr<llvm::Module>> module = llvm::parseBitcodeFile(bitcode, llvmContext);
+		if (!module) {
+			errors[index] = "Could not read module partition: " + llvm::toString(module.takeError());
+			return;
+		}
+		std::unique_ptr<llvm::TargetMachine> targetMachine = createTargetMachine(context, errors[index]);
+		if (!targetMachine)
+			return;
+		errors[index] = emitObjectFile(*targetMachine, **module, objects[index]);
+	});
+	return errors;
+}
 
+bool emitNativeExecutable(ParseContext &context) {
+	// Create target machine
+	std::string error;
+	std::unique_ptr<llvm::TargetMachine> targetMachine = createTargetMachine(context, error);
 	if (!targetMachine) {
-		context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "Failed to create target machine", Range()));
+		context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, error, Range()));
 		return false;
 	}
 
-	context.llvmModule->setDataLayout(targetMachine->createDataLayout());
-
 	// Determine output path
 	std::string outputPath = context.options.outputPath;
 	if (outputPath.empty()) {
@@ -51,33 +84,51 @@ bool emitNativeExecutable(ParseContext &context) {
 		}
 	}
 
-	// Create object file path
-	std::string objectPath = outputPath + ".o";
+	// Emit object files: one, or one per part of the module if it's big enough to split
+	std::vector<llvm::SmallString<0>> objects(std::max<size_t>(partitionCount(context), 1));
+	std::vector<std::string> errors;
+	if (objects.size() == 1)
+		errors.push_back(emitObjectFile(*targetMachine, *context.llvmModule, objects[0]));
+	else
+		errors = emitObjectFiles(context, objects);
+	bool emitted = true;
+	for (const std::string &objectError : errors) {
+		if (!objectError.empty()) {
+			context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, objectError, Range()));
+			emitted = false;
+		}
+	}
+	if (!emitted)
+		return false;
+
+	std::string linkError;
+	if (linkInProcess(context, context.llvmModule->getTargetTriple(), objects, outputPath, linkError)) {
+		if (linkError.empty())
+			return true;
+		context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "Linking failed: " + linkError, Range()));
+		return false;
+	}
 
-	// Emit object file
-	{
+	// Write the object files for the system linker
+	std::vector<std::string> objectPaths;
+	for (size_t index = 0; index < objects.size(); index++) {
+		objectPaths.push_back(objects.size() == 1 ? outputPath + ".o" : outputPath + "." + std::to_string(index) + ".o");
 		std::error_code ec;
-		llvm::raw_fd_ostream dest(objectPath, ec, llvm::sys::fs::OF_None);
+		llvm::raw_fd_ostream dest(objectPaths.back(), ec, llvm::sys::fs::OF_None);
 		if (ec) {
 			context.diagnostics.push_back(
 				Diagnostic(Diagnostic::Level::Error, "Could not open object file: " + ec.message(), Range())
 			);
 			return false;
 		}
-
-		llvm::legacy::PassManager passManager;
-		if (targetMachine->addPassesToEmitFile(passManager, dest, nullptr, llvm::CodeGenFileType::ObjectFile)) {
-			context.diagnostics.push_back(
-				Diagnostic(Diagnostic::Level::Error, "Target machine cannot emit object file", Range())
-			);
-			return false;
-		}
-
-		passManager.run(*context.llvmModule);
+		dest << objects[index];
 	}
 
-	// Link object file to executable using system linker
-	std::string linkCommand = "cc " + objectPath + " -o " + outputPath;
+	// Link object files to executable using system linker
+	std::string linkCommand = "cc";
+	for (const std::string &objectPath : objectPaths)
+		linkCommand += " " + objectPath;
+	linkCommand += " -o " + outputPath;
 
 	// Add any required libraries
 	for (const std::string &lib : context.requiredLibraries) {
@@ -92,8 +143,9 @@ bool emitNativeExecutable(ParseContext &context) {
 		return false;
 	}
 
-	// Clean up object file
-	std::filesystem::remove(objectPath);
+	// Clean up object files
+	for (const std::string &objectPath : objectPaths)
+		std::filesystem::remove(objectPath);
 
 	return true;
 }
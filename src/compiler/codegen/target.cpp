@@ -0,0 +1,65 @@
+#include "target.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/TargetParser/Host.h"
+
+void resolveTargetCpu(ParseContext &context) {
+	ParseContext::Options &options = context.options;
+	if (options.targetCpu != "native" && !(options.targetCpu.empty() && options.run)) {
+		if (options.targetCpu.empty())
+			options.targetCpu = "generic";
+		return;
+	}
+	options.targetCpu = llvm::sys::getHostCPUName().str();
+#if LLVM_VERSION_MAJOR >= 19
+	llvm::StringMap<bool> hostFeatures = llvm::sys::getHostCPUFeatures();
+#else
+	llvm::StringMap<bool> hostFeatures;
+	llvm::sys::getHostCPUFeatures(hostFeatures);
+#endif
+	// the features of -mattr come last, so they override the ones of this machine
+	std::string features;
+	for (const llvm::StringMapEntry<bool> &feature : hostFeatures)
+		features += (feature.getValue() ? "+" : "-") + feature.getKey().str() + ",";
+	if (options.targetFeatures.empty() && !features.empty())
+		features.pop_back();
+	options.targetFeatures = features + options.targetFeatures;
+}
+
+std::unique_ptr<llvm::TargetMachine> createTargetMachine(const ParseContext &context, std::string &error) {
+	std::string targetTriple = llvm::sys::getDefaultTargetTriple();
+	const llvm::Target *target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
+	if (!target) {
+		error = "Failed to get target: " + error;
+		return nullptr;
+	}
+	// LLVM aborts for CPUs it doesn't know once it generates code for them
+	std::unique_ptr<llvm::MCSubtargetInfo> subtargetInfo(target->createMCSubtargetInfo(targetTriple, "", ""));
+	if (!subtargetInfo->isCPUStringValid(context.options.targetCpu)) {
+		error = "Unknown CPU for " + targetTriple + ": " + context.options.targetCpu;
+		return nullptr;
+	}
+	llvm::TargetOptions options;
+	std::unique_ptr<llvm::TargetMachine> targetMachine(target->createTargetMachine(
+		targetTriple, context.options.targetCpu, context.options.targetFeatures, options, llvm::Reloc::PIC_, std::nullopt,
+		context.options.optimizationLevel >= 2 ? llvm::CodeGenOptLevel::Aggressive : llvm::CodeGenOptLevel::Default
+	));
+	if (!targetMachine)
+		error = "Failed to create target machine";
+	return targetMachine;
+}
+
+void addTargetAttributes(ParseContext &context) {
+	for (llvm::Function &function : *context.llvmModule) {
+		if (function.isDeclaration())
+			continue;
+		function.addFnAttr("target-cpu", context.options.targetCpu);
+		if (!context.options.targetFeatures.empty())
+			function.addFnAttr("target-features", context.options.targetFeatures);
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "parseContext.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+class TargetMachine;
+}
+
+// Replace -march=native, and the CPU of --run which runs the code on this machine, with the CPU and features of this
+// machine. Afterwards the options hold the CPU and features the code is generated for.
+void resolveTargetCpu(ParseContext &context);
+
+// A target machine for the CPU and features of the options, or nullptr with the error message. A target machine emits
+// one module at a time, so each worker creates its own.
+std::unique_ptr<llvm::TargetMachine> createTargetMachine(const ParseContext &context, std::string &error);
+
+// set the CPU and features of the options on the functions of the module, which the optimizations use to pick
+// instructions, like the vector width of the loop vectorizer
+void addTargetAttributes(ParseContext &context);
@@ -2,103 +2,31 @@
 #include "IndentData.h"
 #include "classSection.h"
 #include "expression.h"
-#include "lsp/fileSystem.h"
-#include "lsp/sourceFile.h"
+#include "parallelFor.h"
 #include "patternElement.h"
+#include "patternMatcher.h"
 #include "patternTreeNode.h"
 #include "stringFunctions.h"
 #include "type.h"
 #include "variable.h"
 #include <algorithm>
 #include <list>
+#include <numeric>
+#include <optional>
 #include <ranges>
-#include <regex>
 #include <unordered_set>
-using namespace std::literals;
-
-// Find the position of # that's not inside a string literal
-// Returns npos if no comment found
-size_t findCommentStart(std::string_view line) {
-	bool inString = false;
-	for (size_t i = 0; i < line.size(); i++) {
-		char c = line[i];
-		if (c == '"' && (i == 0 || line[i - 1] != '\\')) {
-			inString = !inString;
-		} else if (c == '#' && !inString) {
-			return i;
-		}
-	}
-	return std::string_view::npos;
-}
-
-// regex for line terminators - matches each line including its terminator
-const std::regex lineWithTerminatorRegex("([^\r\n]*(?:\r\n|\r|\n))|([^\r\n]+$)");
 
 bool compile(const std::string &path, ParseContext &context) {
 	// first, read all source files
-	return importSourceFile(path, context) && analyzeSections(context) && resolvePatterns(context) && inferTypes(context);
+	return importSourceFile(path, context) && analyzeSections(context) && resolvePatterns(context) &&
+		   bindVariables(context) && inferTypes(context);
 }
 
-bool importSourceFile(const std::string &path, ParseContext &context) {
-	// Check if already imported (circular import protection)
-	if (context.importedFiles.contains(path)) {
-		return true; // Already processed, skip
-	}
-
-	lsp::SourceFile *sourceFile = context.fileSystem->getFile(path);
-	if (!sourceFile) {
-		if (context.importedFiles.empty()) {
-			// If this is the main file, report error
-			context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "couldn't import main file: " + path, Range()));
-		}
-		return false;
-	}
-
-	context.importedFiles[path] = sourceFile;
-
-	// iterate over lines, each match includes the line terminator
-	std::string_view fileView{sourceFile->content};
-
-	std::cregex_iterator iter(fileView.begin(), fileView.end(), lineWithTerminatorRegex);
-	std::cregex_iterator end;
-	int sourceFileLineIndex = 0;
-	for (; iter != end; ++iter, ++sourceFileLineIndex) {
-		std::string_view lineString = fileView.substr(iter->position(), iter->length());
-		CodeLine *line = new CodeLine(lineString, sourceFile);
-		line->sourceFileLineIndex = sourceFileLineIndex;
-		// first, remove comments and trim whitespace from the right
-		size_t commentPos = findCommentStart(lineString);
-		std::string_view withoutComment =
-			(commentPos != std::string_view::npos) ? lineString.substr(0, commentPos) : lineString;
-
-		// trim trailing whitespace
-		std::cmatch match;
-		std::regex_search(withoutComment.begin(), withoutComment.end(), match, std::regex("[\\s]+$"));
-		line->rightTrimmedText = match.empty() ? withoutComment : withoutComment.substr(0, match.position());
-
-		// check if the line is an import statement
-		if (line->rightTrimmedText.starts_with("import ")) {
-			// recursively import the file, replacing this line with the imported content
-			std::string_view importPath = line->rightTrimmedText.substr("import "sv.length());
-			if (!importSourceFile((std::string)importPath, context)) {
-				context.diagnostics.push_back(Diagnostic(
-					Diagnostic::Level::Error, "failed to import source file: " + (std::string)importPath,
-					Range(line, "import "sv.length(), line->rightTrimmedText.length())
-				));
-				return false;
-			}
-			continue;
-		}
-		line->mergedLineIndex = context.codeLines.size();
-		context.codeLines.push_back(line);
-	}
-	return true;
-}
-
-// step 2: analyze sections
-bool analyzeSections(ParseContext &context) {
+// Split the code lines into sections by their indentation. The lines whose expression is detected are added to
+// context.patternDetections.
+static bool buildSections(ParseContext &context) {
 	IndentData data{};
-	Section *currentSection = context.mainSection = new Section(SectionType::Custom);
+	Section *currentSection = context.mainSection = context.arena.create<Section>(SectionType::Custom);
 	int compiledLineIndex = 0;
 	// code lines are added in import order, meaning lines get replaced with
 	// code from imported files. we assume that the indent level of the code of
@@ -115,9 +43,7 @@ bool analyzeSections(ParseContext &context) {
 
 		int oldIndentLevel = data.indentLevel;
 		// check indent level
-		std::cmatch match;
-		std::regex_search(line->rightTrimmedText.begin(), line->rightTrimmedText.end(), match, std::regex("^(\\s*)"));
-		std::string indentString = match[0];
+		std::string_view indentString = line->indentation;
 		if (data.indentString.empty()) {
 			data.indentString = indentString;
 			data.indentLevel = !indentString.empty();
@@ -198,6 +124,16 @@ bool analyzeSections(ParseContext &context) {
 		}
 		++compiledLineIndex;
 	}
+	return true;
+}
+
+// step 2: analyze sections
+bool analyzeSections(ParseContext &context) {
+	bool sectionsBuilt = buildSections(context);
+	// the lines before a fatal indentation error are detected too, so their diagnostics are reported
+	detectExpressions(context);
+	if (!sectionsBuilt)
+		return false;
 
 	// Create instantiations for class definitions where all fields have declared types
 	std::function<void(Section *)> createDeclaredInstantiations = [&](Section *section) {
@@ -230,7 +166,7 @@ bool analyzeSections(ParseContext &context) {
 void addVariableReferencesFromMatch(ParseContext &context, PatternReference *reference, PatternMatch &match) {
 	int offset = reference->range().start();
 	for (VariableMatch &varMatch : match.discoveredVariables) {
-		VariableReference *varRef = new VariableReference(
+		VariableReference *varRef = context.arena.create<VariableReference>(
 			Range(reference->range().line, offset + varMatch.lineStartPos, offset + varMatch.lineEndPos), varMatch.name
 		);
 		varMatch.variableReference = varRef;
@@ -241,51 +177,50 @@ void addVariableReferencesFromMatch(ParseContext &context, PatternReference *ref
 	}
 }
 
-void expandMatch(Expression *rootExpression, Expression *expr, PatternMatch *match) {
+void expandMatch(ParseContext &context, Expression *rootExpression, Expression *expr, PatternMatch *match) {
 	expr->arguments = match->arguments;
 	// move arguments to the appropriate submatches
 	expr->kind = Expression::Kind::PatternCall;
 	expr->patternMatch = match;
 	for (const PatternMatch &subMatch : match->subMatches) {
-		Expression *arg = new Expression();
+		Expression *arg = context.arena.create<Expression>();
 		arg->range = Range(
 			expr->range.line, rootExpression->range.start() + subMatch.lineStartPos,
 			rootExpression->range.start() + subMatch.lineEndPos
 		);
-		expandMatch(rootExpression, arg, const_cast<PatternMatch *>(&subMatch));
-		expr->arguments.push_back(arg);
+		expandMatch(context, rootExpression, arg, const_cast<PatternMatch *>(&subMatch));
+		expr->arguments.pushBack(arg);
 	}
 
 	// Handle discoveredVariables - add Variable expressions using stored references
 	for (const VariableMatch &varMatch : match->discoveredVariables) {
-		Expression *arg = new Expression();
+		Expression *arg = context.arena.create<Expression>();
 		arg->kind = Expression::Kind::Variable;
 		arg->variable = varMatch.variableReference;
 		arg->range = varMatch.variableReference->range;
-		expr->arguments.push_back(arg);
+		expr->arguments.pushBack(arg);
 	}
 
 	// Handle discoveredWords - add string Literal expressions
 	for (const WordMatch &wordMatch : match->discoveredWords) {
-		Expression *arg = new Expression();
-		arg->kind = Expression::Kind::Literal;
-		arg->literalValue = wordMatch.text;
+		Expression *arg = context.arena.create<Expression>();
+		arg->setString(context.symbols, wordMatch.text);
 		arg->range = Range(
 			rootExpression->range.line, rootExpression->range.start() + wordMatch.lineStartPos,
 			rootExpression->range.start() + wordMatch.lineEndPos
 		);
-		expr->arguments.push_back(arg);
+		expr->arguments.pushBack(arg);
 	}
 }
 
 // Recursively expand pending expressions to their resolved forms
-void expandExpression(Expression *expr, Section *section) {
+void expandExpression(ParseContext &context, Expression *expr, Section *section) {
 	if (!expr)
 		return;
 
 	// Expand children first
 	for (Expression *arg : expr->arguments) {
-		expandExpression(arg, section);
+		expandExpression(context, arg, section);
 	}
 
 	// If this is a pending expression, resolve it
@@ -294,107 +229,224 @@ void expandExpression(Expression *expr, Section *section) {
 	if (expr->kind == Expression::Kind::Pending) {
 		PatternReference *ref = expr->patternReference;
 		if (ref->match) {
-			expandMatch(expr, expr, ref->match);
+			expandMatch(context, expr, expr, ref->match);
 		} else if (ref->patternElements.size() == 1 && ref->patternElements[0].type == PatternElement::Type::Variable) {
 			// Resolved to a variable reference
 			expr->kind = Expression::Kind::Variable;
 			// Find the variable reference in the section
 			std::string varName = ref->patternElements[0].text;
-			auto it = section->variableReferences.find(varName);
-			if (it != section->variableReferences.end() && !it->second.empty()) {
-				expr->variable = it->second.front();
+			if (section->variableTables) {
+				auto it = section->variableTables->references.find(varName);
+				if (it != section->variableTables->references.end() && !it->second.empty())
+					expr->variable = it->second.front();
 			}
 		} else if (expr->arguments.size() == 1 && expr->arguments[0]->kind == Expression::Kind::IntrinsicCall) {
 			// If the pattern is just an argument placeholder and we have a single intrinsic call,
 			// promote the intrinsic to be this expression
 			Expression *intrinsic = expr->arguments[0];
 			expr->kind = intrinsic->kind;
-			expr->intrinsicName = intrinsic->intrinsicName;
+			expr->intrinsic = intrinsic->intrinsic;
 			expr->arguments = intrinsic->arguments;
 			expr->range = intrinsic->range;
 		}
 	}
 }
 
-// Collect all body references from a definition section's descendants (including through nested definitions,
-// since nested code can access parent parameters).
-static void collectBodyReferences(Section *section, std::vector<PatternReference *> &refs) {
-	for (Section *child : section->children) {
-		refs.insert(refs.end(), child->patternReferences.begin(), child->patternReferences.end());
-		collectBodyReferences(child, refs);
+// the counts in variableLikeCounts which each body reference is counted in
+using VariableLikeIndex = std::unordered_map<const PatternReference *, std::vector<int *>>;
+
+// Count the references in the section and its descendants for the definition sections around them, and index which
+// counts each reference is in. definitionSections are the sections around the section which have counts.
+static void indexVariableLikes(Section *section, std::vector<Section *> &definitionSections, VariableLikeIndex &index) {
+	if (!definitionSections.empty()) {
+		std::vector<const std::string *> referenceTexts;
+		auto dereference = [](const std::string *text) -> const std::string & { return *text; };
+		for (PatternReference *reference : section->patternReferences) {
+			// a reference is counted once per text, however often it contains it
+			referenceTexts.clear();
+			for (const PatternElement &element : reference->patternElements) {
+				if (element.type == PatternElement::Type::VariableLike &&
+					std::ranges::find(referenceTexts, element.text, dereference) == referenceTexts.end())
+					referenceTexts.push_back(&element.text);
+			}
+			for (Section *definitionSection : definitionSections) {
+				auto &counts = definitionSection->definitionTables->variableLikeCounts;
+				for (const std::string *text : referenceTexts) {
+					auto count = counts.find(*text);
+					if (count != counts.end()) {
+						count->second++;
+						index[reference].push_back(&count->second);
+					}
+				}
+			}
+		}
 	}
+	// nested code can access the parameters of the definitions around it
+	bool hasCounts = section->definitionTables && !section->definitionTables->variableLikeCounts.empty();
+	if (hasCounts)
+		definitionSections.push_back(section);
+	for (Section *child : section->children)
+		indexVariableLikes(child, definitionSections, index);
+	if (hasCounts)
+		definitionSections.pop_back();
 }
 
-// Compute initial variableLikeCounts for each definition section.
-static void computeVariableLikeCounts(std::list<Section *> &sections) {
+// Compute initial variableLikeCounts for each definition section: the number of references in its descendants which
+// contain each VariableLike text of its definitions.
+static VariableLikeIndex computeVariableLikeCounts(ParseContext &context, std::list<Section *> &sections) {
 	for (Section *section : sections) {
-		std::vector<PatternReference *> bodyRefs;
-		collectBodyReferences(section, bodyRefs);
-
-		// Collect all VL texts from all definitions in this section
-		std::unordered_set<std::string> vlTexts;
 		for (PatternDefinition *def : section->patternDefinitions) {
 			forEachLeafElement(def->patternElements, [&](PatternElement &elem) {
 				if (elem.type == PatternElement::Type::VariableLike)
-					vlTexts.insert(elem.text);
+					section->getDefinitionTables(context.arena).variableLikeCounts[elem.text] = 0;
 			});
 		}
+	}
+	VariableLikeIndex index;
+	std::vector<Section *> definitionSections;
+	indexVariableLikes(context.mainSection, definitionSections, index);
+	return index;
+}
 
-		// Count body references that contain each VL text
-		for (const std::string &vlText : vlTexts) {
-			int count = 0;
-			for (PatternReference *ref : bodyRefs) {
-				for (const PatternElement &refElem : ref->patternElements) {
-					if (refElem.type == PatternElement::Type::VariableLike && refElem.text == vlText) {
-						count++;
-						break;
+// After a body reference resolves to a pattern, decrement the VL counts it was counted in. A reference resolving to a
+// variable keeps its counts, since it uses the text as a variable.
+static void decrementVariableLikeCounts(const VariableLikeIndex &index, PatternReference *reference) {
+	auto counts = index.find(reference);
+	if (!reference->match || counts == index.end())
+		return;
+	for (int *count : counts->second) {
+		if (*count > 0)
+			(*count)--;
+	}
+}
+
+// Resolve a pattern reference with the result of matching it. Returns true if it resolved.
+static bool resolveReference(ParseContext &context, PatternReference *reference, std::optional<PatternMatch> &match) {
+	if (match) {
+		PatternMatch *storedMatch = context.arena.create<PatternMatch>(std::move(*match));
+		reference->resolve(storedMatch);
+		addVariableReferencesFromMatch(context, reference, *storedMatch);
+	} else if (reference->patternElements.size() == 1 &&
+			   reference->patternElements[0].type == PatternElement::Type::VariableLike) {
+		reference->patternElements[0].type = PatternElement::Type::Variable;
+		reference->resolve();
+		reference->range().section()->addVariableReference(
+			context, context.arena.create<VariableReference>(reference->range(), reference->patternElements[0].text)
+		);
+	}
+	return reference->resolved;
+}
+
+// Match the references against the trees on the worker threads, one matcher per worker. Matching only reads the trees
+// and the reference, so the matches don't depend on each other. They're stored by index, to be applied in order after.
+// If emptySlots is given, the empty slots each failed match looked at are stored in it by index too.
+static void matchReferences(
+	const ParseContext &context, std::vector<PatternMatcher> &matchers, const std::vector<PatternReference *> &references,
+	std::vector<std::optional<PatternMatch>> &matches, std::vector<std::vector<PatternTreeSlot>> *emptySlots
+) {
+	// starting a thread costs about as much as a few hundred matches
+	constexpr size_t minimumReferencesPerWorker = 256;
+	matches.assign(references.size(), std::nullopt);
+	if (emptySlots)
+		emptySlots->resize(references.size());
+	size_t workerCount = std::min(matchers.size(), references.size() / minimumReferencesPerWorker);
+	parallelFor(references.size(), workerCount, [&](size_t worker, size_t index) {
+		std::vector<PatternTreeSlot> *referenceSlots = nullptr;
+		if (emptySlots) {
+			referenceSlots = &(*emptySlots)[index];
+			referenceSlots->clear();
+		}
+		matches[index] = matchers[worker].find(context, references[index], referenceSlots);
+	});
+}
+
+// Add the definitions of a section to the tree which can be resolved. Returns true if all of them are.
+// The tree slots the definitions filled are added to filledSlots.
+static bool resolveSectionDefinitions(ParseContext &context, Section *section, std::vector<PatternTreeSlot> &filledSlots) {
+	SectionType treeType = section->type == SectionType::Class ? SectionType::Expression : section->type;
+	section->patternDefinitionsResolved = true;
+	for (PatternDefinition *definition : section->patternDefinitions) {
+		if (!definition->resolved) {
+			definition->resolved = true;
+			forEachLeafElement(definition->patternElements, [&](PatternElement &element) {
+				if (element.type == PatternElement::Type::VariableLike) {
+					if (definition->patternElements.size() > 1) {
+						if (section->getDefinitionTables(context.arena).variableLikeCounts[element.text] == 0) {
+							// No body references use this as a variable — classify as text
+							element.type = PatternElement::Type::Other;
+						} else {
+							definition->resolved = false;
+							section->patternDefinitionsResolved = false;
+						}
 					}
 				}
+			});
+			if (definition->resolved) {
+				context.patternTrees[(size_t)treeType]->addPatternPart(
+					context.arena, definition->patternElements, definition, 0, &filledSlots
+				);
+				context.patternTreeGeneration++;
 			}
-			section->variableLikeCounts[vlText] = count;
 		}
 	}
-}
-
-// After a body reference resolves, decrement VL counts on all ancestor definition sections
-// (nested code can access parent parameters).
-static void decrementVariableLikeCounts(PatternReference *reference) {
-	Section *sec = reference->range().section();
-	while (sec) {
-		if (!sec->patternDefinitions.empty()) {
-			for (const PatternElement &refElem : reference->patternElements) {
-				if (refElem.type == PatternElement::Type::VariableLike) {
-					auto it = sec->variableLikeCounts.find(refElem.text);
-					if (it != sec->variableLikeCounts.end() && it->second > 0)
-						it->second--;
-				}
+	if (!section->patternDefinitionsResolved) {
+		section->patternDefinitionsResolved = section->unresolvedCount == 0;
+	}
+	if (section->patternDefinitionsResolved) {
+		for (PatternDefinition *definition : section->patternDefinitions) {
+			if (!definition->resolved) {
+				definition->resolved = true;
+				context.patternTrees[(size_t)treeType]->addPatternPart(
+					context.arena, definition->patternElements, definition, 0, &filledSlots
+				);
+				context.patternTreeGeneration++;
 			}
 		}
-		sec = sec->parent;
 	}
+	return section->patternDefinitionsResolved;
 }
 
-// Resolve a list of pattern references against the tree. Returns true if all resolved.
-static bool resolveReferences(ParseContext &context, std::list<PatternReference *> &references, bool decrementCounts) {
-	return std::erase_if(references, [&context, decrementCounts](PatternReference *reference) {
-		PatternMatch *match = context.match(reference);
-		if (match) {
-			reference->resolve(match);
-			addVariableReferencesFromMatch(context, reference, *match);
-			if (decrementCounts)
-				decrementVariableLikeCounts(reference);
-		} else if (reference->patternElements.size() == 1 &&
-				   reference->patternElements[0].type == PatternElement::Type::VariableLike) {
-			reference->patternElements[0].type = PatternElement::Type::Variable;
-			reference->resolve();
-			reference->range().section()->addVariableReference(
-				context, new VariableReference(reference->range(), reference->patternElements[0].text)
-			);
-			if (decrementCounts)
-				decrementVariableLikeCounts(reference);
+// sort the indices and remove duplicates
+static void sortIndices(std::vector<size_t> &indices) {
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+// Add the sections which the pattern calls in the expression run, unless they're reachable already
+static void findCalledSections(Expression *expr, std::vector<Section *> &calledSections) {
+	for (Expression *arg : expr->arguments)
+		findCalledSections(arg, calledSections);
+	if (expr->kind == Expression::Kind::PatternCall && expr->patternMatch && expr->patternMatch->matchedEndNode) {
+		PatternDefinition *definition = expr->patternMatch->matchedEndNode->matchingDefinition;
+		if (definition && definition->section && !definition->section->reachable)
+			calledSections.push_back(definition->section);
+	}
+}
+
+// Mark the sections which code reachable from the main file can run. All code outside of the definitions of imported
+// files is reachable, and the body of an imported definition becomes reachable once reachable code calls it. The
+// definitions of the main file are always reachable, so their bodies are checked even when nothing calls them.
+static void markReachableSections(ParseContext &context) {
+	auto isImportedDefinition = [&context](Section *section) {
+		return !section->patternDefinitions.empty() &&
+			   section->patternDefinitions.front()->range.line->sourceFile != context.mainFile;
+	};
+	std::vector<Section *> reachedSections{context.mainSection};
+	while (!reachedSections.empty()) {
+		Section *section = reachedSections.back();
+		reachedSections.pop_back();
+		if (section->reachable)
+			continue;
+		section->reachable = true;
+		for (CodeLine *line : section->codeLines) {
+			if (line->expression)
+				findCalledSections(line->expression, reachedSections);
 		}
-		return reference->resolved;
-	}) > 0;
+		for (Section *child : section->children) {
+			if (!isImportedDefinition(child))
+				reachedSections.push_back(child);
+		}
+	}
 }
 
 // step 3: loop over code, resolve patterns and build up a pattern tree until all patterns are resolved
@@ -405,77 +457,112 @@ bool resolvePatterns(ParseContext &context) {
 	context.mainSection->collectPatternReferencesAndSections(bodyReferences, globalReferences, unResolvedSections);
 	for (Section *unResolvedSection : unResolvedSections) {
 		for (PatternDefinition *unresolvedDefinition : unResolvedSection->patternDefinitions) {
-			unresolvedDefinition->patternElements = parsePatternElements(unresolvedDefinition->range.subString);
+			unresolvedDefinition->patternElements =
+				parsePatternElements(context.symbols, unresolvedDefinition->range.subString);
 		}
 	}
 	for (PatternReference *ref : bodyReferences)
-		ref->patternElements = getPatternElements(ref->pattern.text);
+		ref->patternElements = getPatternElements(context.symbols, ref->pattern.text);
 	for (PatternReference *ref : globalReferences)
-		ref->patternElements = getPatternElements(ref->pattern.text);
+		ref->patternElements = getPatternElements(context.symbols, ref->pattern.text);
 
 	// Compute initial VL counts before resolution
-	computeVariableLikeCounts(unResolvedSections);
+	VariableLikeIndex variableLikeIndex = computeVariableLikeCounts(context, unResolvedSections);
 
 	// add the roots
-	std::generate(std::begin(context.patternTrees), std::end(context.patternTrees), []() {
-		return new PatternTreeNode(PatternElement::Type::Other, "");
+	std::generate(std::begin(context.patternTrees), std::end(context.patternTrees), [&context]() {
+		return context.arena.create<PatternTreeNode>();
 	});
 
-	// Phase 1: resolve body references and definitions
-	for (int resolutionIteration = 0; resolutionIteration < context.options.maxResolutionIterations; resolutionIteration++) {
-
-		// each iteration, we go over all sections first
-		std::erase_if(unResolvedSections, [&context](Section *section) {
-			section->patternDefinitionsResolved = true;
-			for (PatternDefinition *definition : section->patternDefinitions) {
-				if (!definition->resolved) {
-					definition->resolved = true;
-					forEachLeafElement(definition->patternElements, [&](PatternElement &element) {
-						if (element.type == PatternElement::Type::VariableLike) {
-							if (definition->patternElements.size() > 1) {
-								if (section->variableLikeCounts[element.text] == 0) {
-									// No body references use this as a variable — classify as text
-									element.type = PatternElement::Type::Other;
-								} else {
-									definition->resolved = false;
-									section->patternDefinitionsResolved = false;
-								}
-							}
-						}
-					});
-					if (definition->resolved) {
-						SectionType treeType = section->type == SectionType::Class ? SectionType::Expression : section->type;
-						context.patternTrees[(size_t)treeType]->addPatternPart(definition->patternElements, definition);
-					}
-				}
-			}
-			if (!section->patternDefinitionsResolved) {
-				section->patternDefinitionsResolved = section->unresolvedCount == 0;
-			}
-			if (section->patternDefinitionsResolved) {
-				for (PatternDefinition *definition : section->patternDefinitions) {
-					if (!definition->resolved) {
-						definition->resolved = true;
-						SectionType treeType = section->type == SectionType::Class ? SectionType::Expression : section->type;
-						context.patternTrees[(size_t)treeType]->addPatternPart(definition->patternElements, definition);
-					}
-				}
+	// Phase 1: resolve body references and definitions.
+	// each iteration adds the definitions which can be resolved to the tree, then matches the body references again.
+	// a section can only resolve more definitions after a reference inside it resolved, and a failed match can only
+	// succeed once a definition fills one of the empty slots it looked at. so an iteration only checks the sections and
+	// references which something they wait on changed for, in their original order.
+	std::vector<Section *> sections(unResolvedSections.begin(), unResolvedSections.end());
+	std::vector<PatternReference *> references(bodyReferences.begin(), bodyReferences.end());
+	std::unordered_map<Section *, size_t> sectionIndices;
+	for (size_t sectionIndex = 0; sectionIndex < sections.size(); sectionIndex++)
+		sectionIndices[sections[sectionIndex]] = sectionIndex;
+	// the indices of the pending references which looked at an empty slot
+	std::unordered_map<PatternTreeSlot, std::vector<size_t>, PatternTreeSlot::Hash> waitingReferences;
+	std::vector<size_t> sectionsToCheck(sections.size());
+	std::iota(sectionsToCheck.begin(), sectionsToCheck.end(), 0);
+	std::vector<size_t> referencesToMatch(references.size());
+	std::iota(referencesToMatch.begin(), referencesToMatch.end(), 0);
+	std::vector<PatternTreeSlot> filledSlots;
+	// the references matched this iteration, with their results
+	std::vector<PatternReference *> roundReferences;
+	std::vector<std::optional<PatternMatch>> matches;
+	std::vector<std::vector<PatternTreeSlot>> emptySlots;
+	std::vector<PatternMatcher> matchers(context.jobCount());
+	for (int resolutionIteration = 0; resolutionIteration < context.options.maxResolutionIterations &&
+									  (!sectionsToCheck.empty() || !referencesToMatch.empty());
+		 resolutionIteration++) {
+
+		// each iteration, we go over the sections first
+		filledSlots.clear();
+		for (size_t sectionIndex : sectionsToCheck)
+			resolveSectionDefinitions(context, sections[sectionIndex], filledSlots);
+		sectionsToCheck.clear();
+
+		for (const PatternTreeSlot &slot : filledSlots) {
+			auto waiting = waitingReferences.find(slot);
+			if (waiting != waitingReferences.end()) {
+				referencesToMatch.insert(referencesToMatch.end(), waiting->second.begin(), waiting->second.end());
+				waitingReferences.erase(waiting);
 			}
-			return section->patternDefinitionsResolved;
+		}
+		sortIndices(referencesToMatch);
+		// waiting references aren't removed from the other slots they wait on when they resolve
+		std::erase_if(referencesToMatch, [&references](size_t referenceIndex) {
+			return references[referenceIndex]->resolved;
 		});
 
-		resolveReferences(context, bodyReferences, true);
-
-		if (unResolvedSections.empty() && bodyReferences.empty())
-			break;
+		// the trees don't change while matching, so the references are matched in parallel, then resolved in order
+		roundReferences.clear();
+		for (size_t referenceIndex : referencesToMatch)
+			roundReferences.push_back(references[referenceIndex]);
+		matchReferences(context, matchers, roundReferences, matches, &emptySlots);
+
+		for (size_t roundIndex = 0; roundIndex < roundReferences.size(); roundIndex++) {
+			PatternReference *reference = roundReferences[roundIndex];
+			size_t referenceIndex = referencesToMatch[roundIndex];
+			if (resolveReference(context, reference, matches[roundIndex])) {
+				decrementVariableLikeCounts(variableLikeIndex, reference);
+				// the sections around the reference might resolve more definitions now: their VL counts and unresolved
+				// counts went down, and a variable named like a parameter turns that parameter into a Variable
+				for (Section *section = reference->range().section(); section; section = section->parent) {
+					auto sectionIndex = sectionIndices.find(section);
+					if (sectionIndex != sectionIndices.end() && !section->patternDefinitionsResolved)
+						sectionsToCheck.push_back(sectionIndex->second);
+				}
+			} else {
+				for (const PatternTreeSlot &slot : emptySlots[roundIndex]) {
+					std::vector<size_t> &waiting = waitingReferences[slot];
+					// the match can look at a slot more than once
+					if (waiting.empty() || waiting.back() != referenceIndex)
+						waiting.push_back(referenceIndex);
+				}
+			}
+		}
+		referencesToMatch.clear();
+		sortIndices(sectionsToCheck);
 	}
+	std::erase_if(unResolvedSections, [](Section *section) { return section->patternDefinitionsResolved; });
+	std::erase_if(bodyReferences, [](PatternReference *reference) { return reference->resolved; });
 
-	// Phase 2: resolve global references (all definitions are now in the tree)
-	for (int resolutionIteration = 0; resolutionIteration < context.options.maxResolutionIterations; resolutionIteration++) {
-		resolveReferences(context, globalReferences, false);
-		if (globalReferences.empty())
-			break;
-	}
+	// all definitions are in the trees now. copy them to contiguous arrays for the remaining matches
+	for (PatternTreeNode *&patternTree : context.patternTrees)
+		patternTree = patternTree->freeze(context.arena);
+	context.patternTreeGeneration++;
+
+	// Phase 2: resolve global references. all definitions are in the tree now, so matching again wouldn't change anything
+	roundReferences.assign(globalReferences.begin(), globalReferences.end());
+	matchReferences(context, matchers, roundReferences, matches, nullptr);
+	for (size_t roundIndex = 0; roundIndex < roundReferences.size(); roundIndex++)
+		resolveReference(context, roundReferences[roundIndex], matches[roundIndex]);
+	std::erase_if(globalReferences, [](PatternReference *reference) { return reference->resolved; });
 
 	if (!unResolvedSections.empty() || !bodyReferences.empty() || !globalReferences.empty()) {
 		for (PatternReference *reference : bodyReferences)
@@ -492,8 +579,10 @@ bool resolvePatterns(ParseContext &context) {
 	// All patterns resolved — expand expressions and resolve variable references
 	for (CodeLine *line : context.codeLines) {
 		if (line->expression)
-			expandExpression(line->expression, line->section);
+			expandExpression(context, line->expression, line->section);
 	}
+	// the definitions of imported files only have their bodies bound and inferred when the program uses them
+	markReachableSections(context);
 	for (auto &[name, references] : context.unresolvedVariableReferences) {
 		std::unordered_map<Section *, Section *> sectionToHighest;
 		for (VariableReference *ref : references) {
@@ -502,7 +591,7 @@ bool resolvePatterns(ParseContext &context) {
 				continue;
 			Section *highest = sec;
 			for (Section *a = sec->parent; a; a = a->parent) {
-				if (a->variableReferences.contains(name))
+				if (a->variableTables && a->variableTables->references.contains(name))
 					highest = a;
 			}
 			sectionToHighest[sec] = highest;
@@ -514,8 +603,8 @@ bool resolvePatterns(ParseContext &context) {
 			VariableReference *definition = *std::min_element(groupRefs.begin(), groupRefs.end(), [](auto *a, auto *b) {
 				return a->range.line->mergedLineIndex < b->range.line->mergedLineIndex;
 			});
-			definition->range.section()->variableDefinitions[name] = definition;
-			highestSection->variables[name] = new Variable(name, definition);
+			definition->range.section()->getVariableTables(context.arena).definitions[name] = definition;
+			highestSection->getVariableTables(context.arena).variables[name] = context.arena.create<Variable>(name, definition);
 			for (VariableReference *ref : groupRefs) {
 				if (ref != definition)
 					ref->definition = definition;
@@ -525,233 +614,312 @@ bool resolvePatterns(ParseContext &context) {
 	return true;
 }
 
-// Resolve a variable expression through macro bindings to find the actual variable expression.
-// Stops if the binding is self-referential (call-site variable has the same name as the macro parameter).
-static Expression *
-resolveVarThroughMacro(Expression *expr, const std::unordered_map<std::string, Expression *> &macroBindings) {
+// Resolve a variable expression through the macro bindings of the body being inferred to find the actual variable
+// expression. Arguments are bound resolved already, so a call-site variable with the name of a parameter isn't looked up
+// again.
+static Expression *resolveVarThroughMacro(ParseContext &context, Expression *expr) {
 	if (!expr || expr->kind != Expression::Kind::Variable || !expr->variable)
 		return expr;
-	auto it = macroBindings.find(expr->variable->name);
-	if (it != macroBindings.end() && it->second != expr)
-		return resolveVarThroughMacro(it->second, macroBindings);
-	return expr;
+	Expression *const *binding = context.macroExpressionBindings.find(expr->variable->symbol);
+	return binding ? *binding : expr;
 }
 
 // Resolve an expression's type through macro bindings
-static Type resolveTypeThroughMacro(Expression *expr, const std::unordered_map<std::string, Expression *> &macroBindings) {
-	Expression *resolved = resolveVarThroughMacro(expr, macroBindings);
-	return resolved ? resolved->type : Type{};
+static Type resolveTypeThroughMacro(ParseContext &context, Expression *expr) {
+	Expression *resolved = resolveVarThroughMacro(context, expr);
+	return resolved ? context.typeOf(resolved) : Type{};
 }
 
-// Infer types through a macro body with given parameter bindings. Returns true if anything changed.
-static bool
-inferMacroBody(Section *macroSection, const std::unordered_map<std::string, Expression *> &bindings, ParseContext &context);
+// Infer types through a macro body with the current macro bindings
+static void inferMacroBody(Section *macroSection, ParseContext &context);
 
-// Infer the type of an expression bottom-up. Returns true if the type changed.
-static bool inferExpressionType(
-	Expression *expr, ParseContext &context, const std::unordered_map<std::string, Expression *> &macroBindings = {}
-) {
-	if (!expr)
-		return false;
+// Infer the body of a section for one expansion of the call, unless it was inferred already and nothing it read changed
+// since
+static void
+inferExpansion(Section *section, Expansion &expansion, Instantiation *instantiation, const Expression *call, ParseContext &context);
+
+static const std::unordered_map<uint32_t, uint8_t> *parameterUses(Section *section, Arena &arena);
+
+// Add a use to the parameter an expression of the body refers to
+static void useParameter(std::unordered_map<uint32_t, uint8_t> &uses, const Expression *expr, uint8_t use) {
+	if (expr && expr->kind == Expression::Kind::Variable && expr->variable)
+		uses[expr->variable->symbol] |= use;
+}
 
-	bool changed = false;
+static void findParameterUses(const Expression *expr, std::unordered_map<uint32_t, uint8_t> &uses, Arena &arena) {
+	for (const Expression *arg : expr->arguments)
+		findParameterUses(arg, uses, arena);
+	if (expr->kind == Expression::Kind::IntrinsicCall) {
+		if (expr->intrinsic == Intrinsic::Id::Store)
+			useParameter(uses, expr->arguments[1], Expansion::StoredThrough);
+		else if (expr->intrinsic == Intrinsic::Id::Property || expr->intrinsic == Intrinsic::Id::Cast)
+			useParameter(uses, expr->arguments[2], Expansion::UsedAsName);
+	} else if (expr->kind == Expression::Kind::PatternCall && expr->patternMatch && expr->patternMatch->matchedEndNode) {
+		PatternDefinition *def = expr->patternMatch->matchedEndNode->matchingDefinition;
+		if (!def || !def->section || def->section->type == SectionType::Class)
+			return;
+		// a parameter passed on is used the way the called body uses its own parameter
+		const std::unordered_map<uint32_t, uint8_t> *calleeUses = parameterUses(def->section, arena);
+		for (const ParameterBinding &binding : expr->parameterBindings) {
+			uint8_t use = Expansion::StoredThrough | Expansion::UsedAsName;
+			if (calleeUses) {
+				auto it = calleeUses->find(binding.name);
+				use = it != calleeUses->end() ? it->second : 0;
+			}
+			useParameter(uses, binding.argument, use);
+		}
+	}
+}
+
+static void findParameterUses(Section *section, std::unordered_map<uint32_t, uint8_t> &uses, Arena &arena) {
+	for (CodeLine *line : section->codeLines) {
+		if (line->expression)
+			findParameterUses(line->expression, uses, arena);
+	}
+	for (Section *child : section->children)
+		findParameterUses(child, uses, arena);
+}
+
+// How the body of a section uses its parameters, found once. Returns nullptr while the uses are being found, so a body
+// calling itself uses its arguments in every way
+static const std::unordered_map<uint32_t, uint8_t> *parameterUses(Section *section, Arena &arena) {
+	Section::DefinitionTables &tables = section->getDefinitionTables(arena);
+	if (!tables.parameterUsesFound) {
+		if (tables.findingParameterUses)
+			return nullptr;
+		tables.findingParameterUses = true;
+		findParameterUses(section, tables.parameterUses, arena);
+		tables.findingParameterUses = false;
+		tables.parameterUsesFound = true;
+	}
+	return &tables.parameterUses;
+}
+
+// What inferring a body depends on for an argument: its type, and which variable or literal it is if the body stores
+// through the parameter or uses it as a name
+static Expansion::Argument expansionArgument(Expression *argExpr, Type type, uint8_t use) {
+	Expansion::Argument argument{type, {}, {}};
+	if (!use)
+		return argument;
+	if (argExpr->kind == Expression::Kind::Literal) {
+		if (use & Expansion::UsedAsName)
+			argument.literalValue = argExpr->literalValue;
+		return argument;
+	}
+	argument.identity = argExpr;
+	if (argExpr->kind == Expression::Kind::Variable && argExpr->variable && argExpr->variable->resolved)
+		argument.identity = argExpr->variable->resolved;
+	return argument;
+}
+
+// Infer the type of an expression bottom-up
+static void inferExpressionType(Expression *expr, ParseContext &context) {
+	if (!expr)
+		return;
 
 	// Recurse into arguments first (bottom-up)
 	for (Expression *arg : expr->arguments) {
-		changed |= inferExpressionType(arg, context, macroBindings);
+		inferExpressionType(arg, context);
 	}
 
-	Type oldType = expr->type;
+	// inside an expansion, the type is kept in the expansion instead of the expression
+	Type &type = context.currentExpansion ? context.currentExpansion->types[expr] : expr->type;
 
 	switch (expr->kind) {
 	case Expression::Kind::Literal: {
 		if (std::holds_alternative<int64_t>(expr->literalValue)) {
-			expr->type = {Type::Kind::Numeric};
+			type = {Type::Kind::Numeric};
 		} else if (std::holds_alternative<double>(expr->literalValue)) {
-			expr->type = {Type::Kind::Float, 8}; // C++ double = f64
-		} else if (std::holds_alternative<std::string>(expr->literalValue)) {
-			expr->type = {Type::Kind::Integer, 1, 1};
+			type = {Type::Kind::Float, 8}; // C++ double = f64
+		} else if (std::holds_alternative<std::string_view>(expr->literalValue)) {
+			type = {Type::Kind::Integer, 1, 1};
 		}
 		break;
 	}
 
 	case Expression::Kind::Variable: {
 		if (expr->variable) {
-			std::string varName = expr->variable->name;
 			// Check macro bindings first
-			auto macroIt = macroBindings.find(varName);
-			if (macroIt != macroBindings.end()) {
-				Type boundType = macroIt->second->type;
+			if (Expression *const *binding = context.macroExpressionBindings.find(expr->variable->symbol)) {
+				Type boundType = context.typeOf(*binding);
 				if (boundType.isDeduced()) {
-					expr->type = boundType;
+					type = boundType;
 				}
 				break;
 			}
-			// Look up variable in scope
-			Section *sec = expr->range.line ? expr->range.line->section : nullptr;
-			Variable *var = sec ? sec->findVariable(varName) : nullptr;
+			// the variable in scope
+			Variable *var = expr->variable->resolved;
+			if (var)
+				context.typeDependencies->read(var);
 			if (var && var->type.isDeduced()) {
-				expr->type = var->type;
+				type = var->type;
 			}
 		}
 		break;
 	}
 
 	case Expression::Kind::IntrinsicCall: {
-		if (isArithmeticOperator(expr->intrinsicName)) {
-			if (expr->arguments.size() >= 3) {
-				Type leftType = resolveTypeThroughMacro(expr->arguments[1], macroBindings);
-				Type rightType = resolveTypeThroughMacro(expr->arguments[2], macroBindings);
-				if (leftType.isDeduced() && rightType.isDeduced()) {
-					expr->type = isPointerArithmeticOperator(expr->intrinsicName) ? Type::promoteArithmetic(leftType, rightType)
-																				  : Type::promote(leftType, rightType);
-				}
-			}
-		} else if (isComparisonOperator(expr->intrinsicName)) {
-			expr->type = {Type::Kind::Bool};
-		} else if (expr->intrinsicName == "and" || expr->intrinsicName == "or") {
-			expr->type = {Type::Kind::Bool};
-		} else if (expr->intrinsicName == "not") {
-			expr->type = {Type::Kind::Bool};
-		} else if (expr->intrinsicName == "address of") {
-			if (expr->arguments.size() >= 2) {
-				Type varType = resolveTypeThroughMacro(expr->arguments[1], macroBindings);
-				if (varType.isDeduced())
-					expr->type = varType.pointed();
-			}
-		} else if (expr->intrinsicName == "dereference") {
-			if (expr->arguments.size() >= 2) {
-				Type ptrType = resolveTypeThroughMacro(expr->arguments[1], macroBindings);
-				if (ptrType.isDeduced() && ptrType.isPointer())
-					expr->type = ptrType.dereferenced();
+		Intrinsic::Result result = Intrinsic::get(expr->intrinsic).result;
+		if (result == Intrinsic::Result::Bool)
+			type = {Type::Kind::Bool};
+		else if (result == Intrinsic::Result::Void)
+			type = {Type::Kind::Void};
+
+		switch (expr->intrinsic) {
+		case Intrinsic::Id::Add:
+		case Intrinsic::Id::Subtract:
+		case Intrinsic::Id::Multiply:
+		case Intrinsic::Id::Divide:
+		case Intrinsic::Id::Modulo: {
+			Type leftType = resolveTypeThroughMacro(context, expr->arguments[1]);
+			Type rightType = resolveTypeThroughMacro(context, expr->arguments[2]);
+			if (leftType.isDeduced() && rightType.isDeduced()) {
+				type = Intrinsic::isPointerArithmetic(expr->intrinsic) ? Type::promoteArithmetic(leftType, rightType)
+																	   : Type::promote(leftType, rightType);
 			}
-		} else if (expr->intrinsicName == "store at") {
-			expr->type = {Type::Kind::Void};
-		} else if (expr->intrinsicName == "load at") {
-			expr->type = {Type::Kind::Integer, 8};
-		} else if (expr->intrinsicName == "store") {
-			if (expr->arguments.size() >= 3) {
-				Expression *destExpr = resolveVarThroughMacro(expr->arguments[1], macroBindings);
-				Type valType = resolveTypeThroughMacro(expr->arguments[2], macroBindings);
-				if (destExpr->kind == Expression::Kind::Variable && destExpr->variable && valType.isDeduced()) {
-					Section *sec = destExpr->range.line ? destExpr->range.line->section : nullptr;
-					Variable *var = sec ? sec->findVariable(destExpr->variable->name) : nullptr;
-					if (var && var->type.canRefineTo(valType)) {
-						var->type = valType;
-						changed = true;
-					}
-				} else if (destExpr->kind == Expression::Kind::IntrinsicCall && destExpr->intrinsicName == "property" &&
-						   valType.isDeduced()) {
-					// Storing to a class field: @intrinsic("store", @intrinsic("property", instance, field), value)
-					Type instType = resolveTypeThroughMacro(destExpr->arguments[1], macroBindings);
-					if (instType.kind == Type::Kind::Class && instType.classDefinition && instType.classInstIndex >= 0) {
-						Expression *propExpr = resolveVarThroughMacro(destExpr->arguments[2], macroBindings);
-						std::string fieldName;
-						if (auto *str = std::get_if<std::string>(&propExpr->literalValue))
-							fieldName = *str;
-						if (!fieldName.empty()) {
-							ClassDefinition *classDef = instType.classDefinition;
-							auto &fieldTypes = classDef->instantiations[instType.classInstIndex].fieldTypes;
-							for (size_t i = 0; i < classDef->fields.size(); i++) {
-								if (classDef->fields[i].name == fieldName && fieldTypes[i].canRefineTo(valType)) {
-									fieldTypes[i] = valType;
-									changed = true;
-									break;
-								}
-							}
+			break;
+		}
+		case Intrinsic::Id::Negate: {
+			Type operandType = resolveTypeThroughMacro(context, expr->arguments[1]);
+			if (operandType.isDeduced())
+				type = operandType;
+			break;
+		}
+		case Intrinsic::Id::AddressOf: {
+			Type varType = resolveTypeThroughMacro(context, expr->arguments[1]);
+			if (varType.isDeduced())
+				type = varType.pointed();
+			break;
+		}
+		case Intrinsic::Id::Dereference: {
+			Type ptrType = resolveTypeThroughMacro(context, expr->arguments[1]);
+			if (ptrType.isDeduced() && ptrType.isPointer())
+				type = ptrType.dereferenced();
+			break;
+		}
+		case Intrinsic::Id::LoadAt:
+			type = {Type::Kind::Integer, 8};
+			break;
+		case Intrinsic::Id::Store: {
+			Expression *destExpr = resolveVarThroughMacro(context, expr->arguments[1]);
+			Type valType = resolveTypeThroughMacro(context, expr->arguments[2]);
+			if (destExpr->kind == Expression::Kind::Variable && destExpr->variable && valType.isDeduced()) {
+				Variable *var = destExpr->variable->resolved;
+				if (var)
+					context.typeDependencies->read(var);
+				if (var && var->type.canRefineTo(valType)) {
+					var->type = valType;
+					context.typeDependencies->changed(var);
+				}
+			} else if (destExpr->kind == Expression::Kind::IntrinsicCall && destExpr->intrinsic == Intrinsic::Id::Property &&
+					   valType.isDeduced()) {
+				// Storing to a class field: @intrinsic("store", @intrinsic("property", instance, field), value)
+				Type instType = resolveTypeThroughMacro(context, destExpr->arguments[1]);
+				if (instType.kind == Type::Kind::Class && instType.classDefinition && instType.classInstIndex >= 0) {
+					Expression *propExpr = resolveVarThroughMacro(context, destExpr->arguments[2]);
+					ClassDefinition *classDef = instType.classDefinition;
+					int fieldIndex = classDef->fieldIndex(propExpr->symbol);
+					if (fieldIndex != -1) {
+						context.typeDependencies->read(classDef);
+						Type &fieldType = classDef->instantiations[instType.classInstIndex].fieldTypes[fieldIndex];
+						if (fieldType.canRefineTo(valType)) {
+							fieldType = valType;
+							context.typeDependencies->changed(classDef);
 						}
 					}
 				}
 			}
-			expr->type = {Type::Kind::Void};
-		} else if (expr->intrinsicName == "return") {
+			break;
+		}
+		case Intrinsic::Id::Return:
 			if (expr->arguments.size() >= 2) {
-				Type retType = resolveTypeThroughMacro(expr->arguments[1], macroBindings);
+				Type retType = resolveTypeThroughMacro(context, expr->arguments[1]);
 				if (retType.isDeduced()) {
-					expr->type = retType;
-					if (context.currentInstantiation)
+					type = retType;
+					if (context.currentInstantiation && context.currentInstantiation->returnType != retType) {
 						context.currentInstantiation->returnType = retType;
+						context.typeDependencies->changed(context.currentInstantiation);
+					}
 				}
 			}
-		} else if (expr->intrinsicName == "call") {
+			break;
+		case Intrinsic::Id::Call: {
 			// Format: @intrinsic("call", "library", "function", "return type", args...)
-			if (expr->arguments.size() >= 4) {
-				std::string retTypeStr;
-				if (auto *str = std::get_if<std::string>(&expr->arguments[3]->literalValue))
-					retTypeStr = *str;
-				if (!retTypeStr.empty())
-					expr->type = Type::fromString(retTypeStr);
-			}
-		} else if (expr->intrinsicName == "cast") {
+			std::string retTypeStr;
+			if (auto *str = std::get_if<std::string_view>(&expr->arguments[3]->literalValue))
+				retTypeStr = *str;
+			if (!retTypeStr.empty())
+				type = Type::fromString(retTypeStr);
+			break;
+		}
+		case Intrinsic::Id::Cast: {
 			// Format: @intrinsic("cast", value, type_pattern_or_string[, bit_size])
-			if (expr->arguments.size() >= 3) {
-				// Check if the type argument resolved to a TypeReference (class pattern)
-				Type typeArgType = resolveTypeThroughMacro(expr->arguments[2], macroBindings);
-				if (typeArgType.kind == Type::Kind::TypeReference && typeArgType.classDefinition) {
-					ClassDefinition *classDef = typeArgType.classDefinition;
-					int instIdx = classDef->instantiations.empty() ? -1 : 0;
-					expr->type = {Type::Kind::Class, 0, 0, classDef, instIdx};
-				} else {
-					std::string targetStr;
-					if (auto *str = std::get_if<std::string>(&expr->arguments[2]->literalValue))
-						targetStr = *str;
-					if (targetStr == "integer" || targetStr == "float") {
-						Type::Kind kind = targetStr == "integer" ? Type::Kind::Integer : Type::Kind::Float;
-						int byteSize = 8; // default 64 bit
-						if (expr->arguments.size() >= 4) {
-							if (auto *bits = std::get_if<int64_t>(&expr->arguments[3]->literalValue))
-								byteSize = *bits / 8;
-						}
-						expr->type = {kind, byteSize};
-					} else if (!targetStr.empty()) {
-						expr->type = Type::fromString(targetStr);
+			// Check if the type argument resolved to a TypeReference (class pattern)
+			Type typeArgType = resolveTypeThroughMacro(context, expr->arguments[2]);
+			if (typeArgType.kind == Type::Kind::TypeReference && typeArgType.classDefinition) {
+				ClassDefinition *classDef = typeArgType.classDefinition;
+				context.typeDependencies->read(classDef);
+				int instIdx = classDef->instantiations.empty() ? -1 : 0;
+				type = {Type::Kind::Class, 0, 0, classDef, instIdx};
+			} else {
+				std::string targetStr;
+				if (auto *str = std::get_if<std::string_view>(&expr->arguments[2]->literalValue))
+					targetStr = *str;
+				if (targetStr == "integer" || targetStr == "float") {
+					Type::Kind kind = targetStr == "integer" ? Type::Kind::Integer : Type::Kind::Float;
+					int byteSize = 8; // default 64 bit
+					if (expr->arguments.size() >= 4) {
+						if (auto *bits = std::get_if<int64_t>(&expr->arguments[3]->literalValue))
+							byteSize = *bits / 8;
 					}
+					type = {kind, byteSize};
+				} else if (!targetStr.empty()) {
+					type = Type::fromString(targetStr);
 				}
 			}
-		} else if (expr->intrinsicName == "construct") {
+			break;
+		}
+		case Intrinsic::Id::Construct: {
 			// Format: @intrinsic("construct", type_ref, field_values...)
-			if (expr->arguments.size() >= 2) {
-				Type typeRefType = resolveTypeThroughMacro(expr->arguments[1], macroBindings);
-				if (typeRefType.kind == Type::Kind::TypeReference && typeRefType.classDefinition) {
-					ClassDefinition *classDef = typeRefType.classDefinition;
-					std::vector<Type> fieldTypes;
-					bool allDeduced = true;
-					for (size_t i = 2; i < expr->arguments.size(); i++) {
-						Type ft = resolveTypeThroughMacro(expr->arguments[i], macroBindings);
-						if (!ft.isDeduced())
-							allDeduced = false;
-						fieldTypes.push_back(ft);
-					}
-					if (allDeduced) {
-						int instIdx = classDef->getOrCreateInstantiation(fieldTypes);
-						expr->type = {Type::Kind::Class, 0, 0, classDef, instIdx};
-					}
+			Type typeRefType = resolveTypeThroughMacro(context, expr->arguments[1]);
+			if (typeRefType.kind == Type::Kind::TypeReference && typeRefType.classDefinition) {
+				ClassDefinition *classDef = typeRefType.classDefinition;
+				std::vector<Type> fieldTypes;
+				bool allDeduced = true;
+				for (size_t i = 2; i < expr->arguments.size(); i++) {
+					Type ft = resolveTypeThroughMacro(context, expr->arguments[i]);
+					if (!ft.isDeduced())
+						allDeduced = false;
+					fieldTypes.push_back(ft);
+				}
+				if (allDeduced) {
+					context.typeDependencies->read(classDef);
+					size_t instantiationCount = classDef->instantiations.size();
+					int instIdx = classDef->getOrCreateInstantiation(fieldTypes);
+					if (classDef->instantiations.size() != instantiationCount)
+						context.typeDependencies->changed(classDef);
+					type = {Type::Kind::Class, 0, 0, classDef, instIdx};
 				}
 			}
-		} else if (expr->intrinsicName == "property") {
+			break;
+		}
+		case Intrinsic::Id::Property: {
 			// Format: @intrinsic("property", instance, fieldname_string)
 			// instance type must be Class, fieldname is a string literal from {word:} capture
-			if (expr->arguments.size() >= 3) {
-				Type instType = resolveTypeThroughMacro(expr->arguments[1], macroBindings);
-				if (instType.kind == Type::Kind::Class && instType.classDefinition && instType.classInstIndex >= 0) {
-					Expression *propExpr = resolveVarThroughMacro(expr->arguments[2], macroBindings);
-					std::string fieldName;
-					if (auto *str = std::get_if<std::string>(&propExpr->literalValue))
-						fieldName = *str;
-					if (!fieldName.empty()) {
-						ClassDefinition *classDef = instType.classDefinition;
-						for (size_t i = 0; i < classDef->fields.size(); i++) {
-							if (classDef->fields[i].name == fieldName) {
-								expr->type = classDef->instantiations[instType.classInstIndex].fieldTypes[i];
-								break;
-							}
-						}
-					}
+			Type instType = resolveTypeThroughMacro(context, expr->arguments[1]);
+			if (instType.kind == Type::Kind::Class && instType.classDefinition && instType.classInstIndex >= 0) {
+				Expression *propExpr = resolveVarThroughMacro(context, expr->arguments[2]);
+				ClassDefinition *classDef = instType.classDefinition;
+				int fieldIndex = classDef->fieldIndex(propExpr->symbol);
+				if (fieldIndex != -1) {
+					context.typeDependencies->read(classDef);
+					type = classDef->instantiations[instType.classInstIndex].fieldTypes[fieldIndex];
 				}
 			}
-		} else if (expr->intrinsicName == "loop while" || expr->intrinsicName == "if" || expr->intrinsicName == "else if" ||
-				   expr->intrinsicName == "else" || expr->intrinsicName == "switch" || expr->intrinsicName == "case") {
-			expr->type = {Type::Kind::Void};
+			break;
+		}
+		default:
+			break;
 		}
 		break;
 	}
@@ -762,65 +930,44 @@ static bool inferExpressionType(
 			if (def && def->section) {
 				Section *matchedSection = def->section;
 
-				// Build parameter bindings from call-site arguments
-				std::vector<Expression *> sortedArgs = sortArgumentsByPosition(expr->arguments);
-
-				std::unordered_map<std::string, Expression *> callBindings;
-				size_t argIndex = 0;
-				for (PatternTreeNode *node : expr->patternMatch->nodesPassed) {
-					auto paramIt = node->parameterNames.find(def);
-					if (paramIt != node->parameterNames.end() && argIndex < sortedArgs.size()) {
-						// Resolve through current macro bindings if we're inside a macro
-						Expression *actualArg = sortedArgs[argIndex];
-						if (actualArg->kind == Expression::Kind::Variable && actualArg->variable) {
-							auto macroIt = macroBindings.find(actualArg->variable->name);
-							if (macroIt != macroBindings.end()) {
-								actualArg = macroIt->second;
-							}
-						}
-						callBindings[paramIt->second] = actualArg;
-						argIndex++;
-					}
-				}
-
 				if (matchedSection->type == SectionType::Class) {
 					auto *classSec = static_cast<ClassSection *>(matchedSection);
-					expr->type = {Type::Kind::TypeReference, 0, 0, classSec->classDefinition};
-				} else if (matchedSection->type == SectionType::Effect) {
-					// Effects: infer body, result type is Void
-					changed |= inferMacroBody(matchedSection, callBindings, context);
-					expr->type = {Type::Kind::Void};
-				} else if (matchedSection->isMacro) {
-					// Code replacement: infer body, type = replacement expression type
-					changed |= inferMacroBody(matchedSection, callBindings, context);
-					for (Section *child : matchedSection->children) {
-						for (CodeLine *line : child->codeLines) {
-							if (line->expression && line->expression->type.isDeduced())
-								expr->type = line->expression->type;
-						}
-					}
+					type = {Type::Kind::TypeReference, 0, 0, classSec->classDefinition};
 				} else {
-					// Non-macro function: infer body per-instantiation
-					// Build argTypes in nodesPassed order (must match codegen's paramBindings order)
+					// Build argTypes in parameter order (codegen looks up the instantiation in the same order)
+					Expansion::Key key;
 					std::vector<Type> argTypes;
-					size_t argTypeIndex = 0;
-					for (PatternTreeNode *node : expr->patternMatch->nodesPassed) {
-						auto paramIt = node->parameterNames.find(def);
-						if (paramIt != node->parameterNames.end() && argTypeIndex < sortedArgs.size()) {
-							Expression *argExpr = callBindings[paramIt->second];
-							argTypes.push_back(resolveTypeThroughMacro(argExpr, macroBindings));
-							argTypeIndex++;
-						}
+					const std::unordered_map<uint32_t, uint8_t> &uses = *parameterUses(matchedSection, context.arena);
+					for (const ParameterBinding &binding : expr->parameterBindings) {
+						Expression *argExpr = resolveVarThroughMacro(context, binding.argument);
+						argTypes.push_back(context.typeOf(argExpr));
+						auto use = uses.find(binding.name);
+						key.arguments.push_back(
+							expansionArgument(argExpr, argTypes.back(), use != uses.end() ? use->second : 0)
+						);
+					}
+					// Non-macro functions are inferred per instantiation. Effects and macros are part of the calling one
+					bool isFunction = matchedSection->type != SectionType::Effect && !matchedSection->isMacro;
+					Section::DefinitionTables &tables = matchedSection->getDefinitionTables(context.arena);
+					key.instantiation = isFunction ? &tables.instantiations[argTypes] : context.currentInstantiation;
+					Expansion &expansion = tables.expansions[key];
+					if (context.currentExpansion)
+						context.currentExpansion->callees[expr] = &expansion;
+					else
+						context.callExpansions[expr] = &expansion;
+					inferExpansion(matchedSection, expansion, key.instantiation, expr, context);
+
+					if (matchedSection->type == SectionType::Effect) {
+						type = {Type::Kind::Void};
+					} else if (matchedSection->isMacro) {
+						// Code replacement: type = replacement expression type
+						if (expansion.resultType.isDeduced())
+							type = expansion.resultType;
+					} else {
+						context.typeDependencies->read(key.instantiation);
+						if (key.instantiation->returnType.isDeduced())
+							type = key.instantiation->returnType;
 					}
-
-					Instantiation &inst = matchedSection->instantiations[argTypes];
-					Instantiation *savedInst = context.currentInstantiation;
-					context.currentInstantiation = &inst;
-					changed |= inferMacroBody(matchedSection, callBindings, context);
-					context.currentInstantiation = savedInst;
-
-					if (inst.returnType.isDeduced())
-						expr->type = inst.returnType;
 				}
 			}
 		}
@@ -830,29 +977,76 @@ static bool inferExpressionType(
 	case Expression::Kind::Pending:
 		break;
 	}
-
-	return changed || (expr->type != oldType);
 }
 
-static bool
-inferMacroBody(Section *section, const std::unordered_map<std::string, Expression *> &bindings, ParseContext &context) {
-	bool changed = false;
+static void inferMacroBody(Section *section, ParseContext &context) {
 	for (CodeLine *line : section->codeLines) {
 		if (line->expression)
-			changed |= inferExpressionType(line->expression, context, bindings);
+			inferExpressionType(line->expression, context);
 	}
 	for (Section *child : section->children)
-		changed |= inferMacroBody(child, bindings, context);
-	return changed;
+		inferMacroBody(child, context);
+}
+
+// Give an argument expression and the expressions in it the types and callees they have at the call
+static void copyArgument(ParseContext &context, Expansion &expansion, const Expression *argExpr) {
+	expansion.types[argExpr] = context.typeOf(argExpr);
+	if (Expansion *callee = context.calleeOf(argExpr))
+		expansion.callees[argExpr] = callee;
+	for (const Expression *nested : argExpr->arguments)
+		copyArgument(context, expansion, nested);
+}
+
+static void
+inferExpansion(Section *section, Expansion &expansion, Instantiation *instantiation, const Expression *call, ParseContext &context) {
+	// the body only sees the arguments of the call, resolved through the bindings of the macro the call is in
+	ScopedBindings<Expression *> &bindings = context.macroExpressionBindings;
+	bindings.pushFrame(true);
+	for (const ParameterBinding &binding : call->parameterBindings) {
+		Expression *const *outer = binding.isVariable ? bindings.findOuter(binding.argument->variable->symbol) : nullptr;
+		Expression *argument = outer ? *outer : binding.argument;
+		bindings.bind(binding.name, argument);
+		// the calls sharing this expansion pass different argument expressions, and the types in them can still change
+		copyArgument(context, expansion, argument);
+	}
+	if (expansion.stale) {
+		Expansion *savedExpansion = context.currentExpansion;
+		Instantiation *savedInst = context.currentInstantiation;
+		context.currentExpansion = &expansion;
+		context.currentInstantiation = instantiation;
+		expansion.stale = false;
+		context.typeDependencies->enter(&expansion);
+		inferMacroBody(section, context);
+		context.typeDependencies->leave();
+		context.currentExpansion = savedExpansion;
+		context.currentInstantiation = savedInst;
+
+		if (section->isMacro) {
+			Type resultType;
+			for (Section *child : section->children) {
+				for (CodeLine *line : child->codeLines) {
+					if (line->expression && expansion.typeOf(line->expression).isDeduced())
+						resultType = expansion.typeOf(line->expression);
+				}
+			}
+			if (resultType != expansion.resultType) {
+				expansion.resultType = resultType;
+				context.typeDependencies->changed(&expansion);
+			}
+		}
+	}
+	bindings.popFrame();
+	context.typeDependencies->read(&expansion);
+	// the body changed a type it read itself, so it has to be inferred again
+	if (expansion.stale)
+		context.typeDependencies->changed(&expansion);
 }
 
 // Default a Numeric expression to a sized Integer type.
 // For literals, check if the value fits in i32; otherwise use i64.
 // For non-literal Numeric expressions, default to i32.
-static void defaultNumericExpressions(Expression *expr) {
-	if (!expr)
-		return;
-	if (expr->type.kind == Type::Kind::Numeric) {
+static void defaultNumericType(const Expression *expr, Type &type) {
+	if (type.kind == Type::Kind::Numeric) {
 		int size = 4; // default to i32
 		if (expr->kind == Expression::Kind::Literal) {
 			if (auto *intVal = std::get_if<int64_t>(&expr->literalValue)) {
@@ -860,16 +1054,24 @@ static void defaultNumericExpressions(Expression *expr) {
 					size = 8;
 			}
 		}
-		expr->type = {Type::Kind::Integer, size};
+		type = {Type::Kind::Integer, size};
 	}
+}
+
+static void defaultNumericExpressions(Expression *expr) {
+	if (!expr)
+		return;
+	defaultNumericType(expr, expr->type);
 	for (Expression *arg : expr->arguments)
 		defaultNumericExpressions(arg);
 }
 
 static void defaultNumericTypes(Section *section) {
-	for (auto &[name, var] : section->variables) {
-		if (var->type.kind == Type::Kind::Numeric)
-			var->type = {Type::Kind::Integer, 4}; // default to i32
+	if (section->variableTables) {
+		for (auto &[name, var] : section->variableTables->variables) {
+			if (var->type.kind == Type::Kind::Numeric)
+				var->type = {Type::Kind::Integer, 4}; // default to i32
+		}
 	}
 	// Default Numeric→Integer(4) in class instantiation field types
 	if (section->type == SectionType::Class) {
@@ -881,10 +1083,16 @@ static void defaultNumericTypes(Section *section) {
 			}
 		}
 	}
+	if (Section::DefinitionTables *tables = section->definitionTables) {
+		for (auto &[key, expansion] : tables->expansions) {
+			for (auto &[expr, type] : expansion.types)
+				defaultNumericType(expr, type);
+		}
+	}
 	// Default Numeric→Integer(4) in instantiation map keys
-	if (!section->instantiations.empty()) {
+	if (section->definitionTables && !section->definitionTables->instantiations.empty()) {
 		std::map<std::vector<Type>, Instantiation> updated;
-		for (auto &[argTypes, inst] : section->instantiations) {
+		for (auto &[argTypes, inst] : section->definitionTables->instantiations) {
 			std::vector<Type> defaultedTypes = argTypes;
 			for (Type &t : defaultedTypes) {
 				if (t.kind == Type::Kind::Numeric)
@@ -894,7 +1102,7 @@ static void defaultNumericTypes(Section *section) {
 				inst.returnType = {Type::Kind::Integer, 4};
 			updated[defaultedTypes] = std::move(inst);
 		}
-		section->instantiations = std::move(updated);
+		section->definitionTables->instantiations = std::move(updated);
 	}
 	for (Section *child : section->children)
 		defaultNumericTypes(child);
@@ -910,54 +1118,75 @@ static bool validateExpressionTypes(Expression *expr, ParseContext &context) {
 		valid &= validateExpressionTypes(arg, context);
 
 	if (expr->kind == Expression::Kind::IntrinsicCall) {
-		if (isArithmeticOperator(expr->intrinsicName)) {
-			if (expr->arguments.size() >= 3) {
-				Type leftType = expr->arguments[1]->type;
-				Type rightType = expr->arguments[2]->type;
-				// Pointer arithmetic (ptr + int, ptr - int) is valid
-				bool ptrArith =
-					isPointerArithmeticOperator(expr->intrinsicName) && (leftType.isPointer() || rightType.isPointer());
-				if (!ptrArith && leftType.isDeduced() && !leftType.isNumeric()) {
-					context.diagnostics.push_back(Diagnostic(
-						Diagnostic::Level::Error,
-						"Cannot use " + leftType.toString() + " in arithmetic (expected a numeric type)",
-						expr->arguments[1]->range
-					));
-					valid = false;
-				}
-				if (!ptrArith && rightType.isDeduced() && !rightType.isNumeric()) {
-					context.diagnostics.push_back(Diagnostic(
-						Diagnostic::Level::Error,
-						"Cannot use " + rightType.toString() + " in arithmetic (expected a numeric type)",
-						expr->arguments[2]->range
-					));
-					valid = false;
-				}
+		switch (expr->intrinsic) {
+		case Intrinsic::Id::Add:
+		case Intrinsic::Id::Subtract:
+		case Intrinsic::Id::Multiply:
+		case Intrinsic::Id::Divide:
+		case Intrinsic::Id::Modulo: {
+			Type leftType = context.typeOf(expr->arguments[1]);
+			Type rightType = context.typeOf(expr->arguments[2]);
+			// Pointer arithmetic (ptr + int, ptr - int) is valid
+			bool ptrArith = Intrinsic::isPointerArithmetic(expr->intrinsic) && (leftType.isPointer() || rightType.isPointer());
+			if (!ptrArith && leftType.isDeduced() && !leftType.isNumeric()) {
+				context.diagnostics.push_back(Diagnostic(
+					Diagnostic::Level::Error, "Cannot use " + leftType.toString() + " in arithmetic (expected a numeric type)",
+					expr->arguments[1]->range
+				));
+				valid = false;
 			}
-		} else if (isComparisonOperator(expr->intrinsicName)) {
-			if (expr->arguments.size() >= 3) {
-				Type leftType = expr->arguments[1]->type;
-				Type rightType = expr->arguments[2]->type;
-				if (leftType.isDeduced() && rightType.isDeduced() && !leftType.isNumeric() && !rightType.isNumeric() &&
-					leftType != rightType) {
-					context.diagnostics.push_back(Diagnostic(
-						Diagnostic::Level::Error, "Cannot compare " + leftType.toString() + " with " + rightType.toString(),
-						expr->range
-					));
-					valid = false;
-				}
+			if (!ptrArith && rightType.isDeduced() && !rightType.isNumeric()) {
+				context.diagnostics.push_back(Diagnostic(
+					Diagnostic::Level::Error, "Cannot use " + rightType.toString() + " in arithmetic (expected a numeric type)",
+					expr->arguments[2]->range
+				));
+				valid = false;
 			}
-		} else if (expr->intrinsicName == "negate") {
-			if (expr->arguments.size() >= 2) {
-				Type operandType = expr->arguments[1]->type;
-				if (operandType.isDeduced() && !operandType.isNumeric()) {
-					context.diagnostics.push_back(Diagnostic(
-						Diagnostic::Level::Error, "Cannot negate " + operandType.toString() + " (expected a numeric type)",
-						expr->arguments[1]->range
-					));
-					valid = false;
-				}
+			break;
+		}
+		case Intrinsic::Id::LessThan:
+		case Intrinsic::Id::LessThanOrEqual:
+		case Intrinsic::Id::GreaterThan:
+		case Intrinsic::Id::GreaterThanOrEqual:
+		case Intrinsic::Id::Equal:
+		case Intrinsic::Id::NotEqual: {
+			Type leftType = context.typeOf(expr->arguments[1]);
+			Type rightType = context.typeOf(expr->arguments[2]);
+			if (leftType.isDeduced() && rightType.isDeduced() && !leftType.isNumeric() && !rightType.isNumeric() &&
+				leftType != rightType) {
+				context.diagnostics.push_back(Diagnostic(
+					Diagnostic::Level::Error, "Cannot compare " + leftType.toString() + " with " + rightType.toString(),
+					expr->range
+				));
+				valid = false;
+			}
+			break;
+		}
+		case Intrinsic::Id::Negate: {
+			Type operandType = context.typeOf(expr->arguments[1]);
+			if (operandType.isDeduced() && !operandType.isNumeric()) {
+				context.diagnostics.push_back(Diagnostic(
+					Diagnostic::Level::Error, "Cannot negate " + operandType.toString() + " (expected a numeric type)",
+					expr->arguments[1]->range
+				));
+				valid = false;
 			}
+			break;
+		}
+		case Intrinsic::Id::Property: {
+			Type instanceType = context.typeOf(expr->arguments[1]);
+			if (instanceType.isDeduced() && instanceType.kind != Type::Kind::Class) {
+				context.diagnostics.push_back(Diagnostic(
+					Diagnostic::Level::Error,
+					"Cannot get a property of " + instanceType.toString() + " (expected a class instance)",
+					expr->arguments[1]->range
+				));
+				valid = false;
+			}
+			break;
+		}
+		default:
+			break;
 		}
 	}
 
@@ -966,26 +1195,29 @@ static bool validateExpressionTypes(Expression *expr, ParseContext &context) {
 
 bool inferTypes(ParseContext &context) {
 	// Type inference uses fixed-point iteration: types flow through expressions
-	// until no more changes occur. 64 iterations handles deeply nested expressions
+	// until no more changes occur. 64 sweeps handle deeply nested expressions
 	// with complex type dependencies (macros, pattern calls, arithmetic promotion).
-	for (int iteration = 0; iteration < 64; iteration++) {
-		bool changed = false;
-
-		for (CodeLine *line : context.codeLines) {
-			if (line->expression) {
-				changed |= inferExpressionType(line->expression, context);
-			}
+	// A sweep only visits the lines which read a variable, return, field or expansion type that changed since their last
+	// visit. The body of a macro or function is inferred once per expansion, and again when a type it read changed.
+	// Lines in the unused bodies of imported definitions aren't inferred at all.
+	std::vector<CodeLine *> lines;
+	for (CodeLine *line : context.codeLines) {
+		if (line->expression && line->section->reachable)
+			lines.push_back(line);
+	}
+	TypeDependencies typeDependencies(lines.size());
+	context.typeDependencies = &typeDependencies;
+	for (int iteration = 0; iteration < 64 && typeDependencies.anyPending(); iteration++) {
+		for (size_t lineIndex = 0; lineIndex < lines.size(); lineIndex++) {
+			if (typeDependencies.visit(lineIndex))
+				inferExpressionType(lines[lineIndex]->expression, context);
 		}
-
-		if (!changed)
-			break;
 	}
+	context.typeDependencies = nullptr;
 
 	// Default remaining Numeric types to sized Integer
-	for (CodeLine *line : context.codeLines) {
-		if (line->expression)
-			defaultNumericExpressions(line->expression);
-	}
+	for (CodeLine *line : lines)
+		defaultNumericExpressions(line->expression);
 	defaultNumericTypes(context.mainSection);
 
 	// Validate variables — all must have deduced types
@@ -994,13 +1226,15 @@ bool inferTypes(ParseContext &context) {
 	std::function<void(Section *)> validateVariables = [&](Section *section) {
 		if (section->parent && !section->parent->isMacro && !section->parent->patternDefinitions.empty())
 			return;
-		for (auto &[name, var] : section->variables) {
-			if (!var->type.isDeduced()) {
-				context.diagnostics.push_back(Diagnostic(
-					Diagnostic::Level::Error, "Variable '" + name + "' has no type (never assigned a value)",
-					var->definition->range
-				));
-				valid = false;
+		if (section->reachable && section->variableTables) {
+			for (auto &[name, var] : section->variableTables->variables) {
+				if (!var->type.isDeduced()) {
+					context.diagnostics.push_back(Diagnostic(
+						Diagnostic::Level::Error, "Variable '" + name + "' has no type (never assigned a value)",
+						var->definition->range
+					));
+					valid = false;
+				}
 			}
 		}
 		for (Section *child : section->children)
@@ -1008,22 +1242,38 @@ bool inferTypes(ParseContext &context) {
 	};
 	validateVariables(context.mainSection);
 
-	// Validate expression types
-	for (CodeLine *line : context.codeLines) {
-		if (line->expression)
-			valid &= validateExpressionTypes(line->expression, context);
+	// Validate expression types, and the types of the bodies in each of their expansions
+	size_t firstTypeError = context.diagnostics.size();
+	for (CodeLine *line : lines)
+		valid &= validateExpressionTypes(line->expression, context);
+	std::function<void(Section *)> validateBody = [&](Section *section) {
+		for (CodeLine *line : section->codeLines) {
+			if (line->expression)
+				valid &= validateExpressionTypes(line->expression, context);
+		}
+		for (Section *child : section->children)
+			validateBody(child);
+	};
+	std::function<void(Section *)> validateExpansions = [&](Section *section) {
+		if (section->definitionTables) {
+			for (auto &[key, expansion] : section->definitionTables->expansions) {
+				context.currentExpansion = &expansion;
+				validateBody(section);
+			}
+		}
+		context.currentExpansion = nullptr;
+		for (Section *child : section->children)
+			validateExpansions(child);
+	};
+	validateExpansions(context.mainSection);
+	// expansions of the same body report the same errors
+	std::vector<Diagnostic> typeErrors(context.diagnostics.begin() + firstTypeError, context.diagnostics.end());
+	context.diagnostics.erase(context.diagnostics.begin() + firstTypeError, context.diagnostics.end());
+	std::unordered_set<std::string> reported;
+	for (Diagnostic &typeError : typeErrors) {
+		if (reported.insert(typeError.toString()).second)
+			context.diagnostics.push_back(typeError);
 	}
 
 	return valid;
 }
-
-bool isArithmeticOperator(const std::string &name) {
-	return name == "add" || name == "subtract" || name == "multiply" || name == "divide" || name == "modulo";
-}
-
-bool isPointerArithmeticOperator(const std::string &name) { return name == "add" || name == "subtract"; }
-
-bool isComparisonOperator(const std::string &name) {
-	return name == "less than" || name == "greater than" || name == "equal" || name == "not equal" ||
-		   name == "less than or equal" || name == "greater than or equal";
-}
@@ -7,12 +7,11 @@ struct Section;
 bool compile(const std::string &path, ParseContext &context);
 bool importSourceFile(const std::string &path, ParseContext &context);
 bool analyzeSections(ParseContext &context);
+// Detect the expressions of the lines queued in context.patternDetections on the worker threads
+void detectExpressions(ParseContext &context);
 bool resolvePatterns(ParseContext &context);
+// Resolve the names of variables, class fields and call parameters once, so the passes after it don't look them up
+bool bindVariables(ParseContext &context);
 bool inferTypes(ParseContext &context);
 
-// Intrinsic operator checking utilities
-bool isArithmeticOperator(const std::string &name);
-bool isPointerArithmeticOperator(const std::string &name);
-bool isComparisonOperator(const std::string &name);
-
 // Helper utilities - sortArgumentsByPosition is now inline in expression.h
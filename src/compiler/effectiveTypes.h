@@ -0,0 +1,87 @@
+#pragma once
+#include "type.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+struct Expression;
+// The effective types computed during codegen, so each expression's type is only computed once per instantiation.
+// The effective type of an expression depends on the macro bindings, the parameter types and the current expansion, which
+// stay the same within a scope. A scope is entered when generating a macro body, the body section of a macro call or a
+// function body, after setting those up, and left before restoring them. A type found in a scope is forgotten when the
+// scope is left, since the same expression can be generated again with other bindings.
+class EffectiveTypes {
+  public:
+	void enterScope() { scopes.push_back({nextScope++, stored.size()}); }
+	void leaveScope() {
+		if (stored.size() - firstStored() > linearLimit) {
+			for (size_t index = firstStored(); index < stored.size(); index++)
+				indices.erase({stored[index].expression, currentScope()});
+		}
+		stored.resize(firstStored());
+		scopes.pop_back();
+	}
+	// returns nullptr if the type wasn't stored in the current scope
+	const Type *find(const Expression *expression) const {
+		if (stored.size() - firstStored() <= linearLimit) {
+			for (size_t index = firstStored(); index < stored.size(); index++) {
+				if (stored[index].expression == expression)
+					return &stored[index].type;
+			}
+			return nullptr;
+		}
+		auto it = indices.find({expression, currentScope()});
+		return it != indices.end() ? &stored[it->second].type : nullptr;
+	}
+	// the type mustn't be stored in the current scope yet
+	void store(const Expression *expression, Type type) {
+		stored.push_back({expression, type});
+		size_t count = stored.size() - firstStored();
+		if (count == linearLimit + 1) {
+			// the scope outgrew the linear search: index the types stored so far
+			for (size_t index = firstStored(); index < stored.size(); index++)
+				indices.emplace(Key{stored[index].expression, currentScope()}, index);
+		} else if (count > linearLimit)
+			indices.emplace(Key{expression, currentScope()}, stored.size() - 1);
+	}
+
+  private:
+	struct Key {
+		const Expression *expression;
+		uint32_t scope;
+
+		bool operator==(const Key &other) const = default;
+
+		struct Hash {
+			size_t operator()(const Key &key) const {
+				// spread the scope over all bits. a shift by 32 would be undefined where size_t has 32 bits
+				return std::hash<const void *>()(key.expression) ^
+					   (size_t)(std::hash<uint32_t>()(key.scope) * 0x9e3779b97f4a7c15ull);
+			}
+		};
+	};
+	struct Stored {
+		const Expression *expression;
+		Type type;
+	};
+	struct Scope {
+		uint32_t id;
+		// the index of the first type stored in the scope
+		size_t firstStored;
+	};
+	// most macro bodies only store a few types, which are faster to search than to index
+	static constexpr size_t linearLimit = 8;
+
+	// code outside of any macro or function body is in scope 0
+	uint32_t currentScope() const { return scopes.empty() ? 0 : scopes.back().id; }
+	size_t firstStored() const { return scopes.empty() ? 0 : scopes.back().firstStored; }
+
+	// the types in the order they were stored
+	std::vector<Stored> stored;
+	// the index in stored of each type of a scope with more than linearLimit types
+	std::unordered_map<Key, size_t, Key::Hash> indices;
+	std::vector<Scope> scopes;
+	uint32_t nextScope = 1;
+};
@@ -1,9 +1,14 @@
 #pragma once
+#include "intrinsic.h"
+#include "parameterBinding.h"
 #include "range.h"
+#include "smallVector.h"
+#include "symbolTable.h"
 #include "type.h"
 #include <algorithm>
 #include <cstdint>
-#include <string>
+#include <span>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -12,7 +17,7 @@ struct PatternReference;
 struct VariableReference;
 
 struct Expression {
-	enum class Kind {
+	enum class Kind : uint8_t {
 		Literal,
 		Variable,
 		PatternCall,
@@ -21,11 +26,15 @@ struct Expression {
 	};
 
 	Kind kind = Kind::Pending;
+	// For IntrinsicCall: the intrinsic, resolved from the name in the first argument
+	Intrinsic::Id intrinsic = Intrinsic::Id::Unknown;
+	// For string Literals: the symbol of the text, which field names are matched by
+	uint32_t symbol = noSymbol;
 	Type type;
 	Range range;
 
-	// For Literal: the actual value
-	std::variant<std::monostate, int64_t, double, std::string> literalValue;
+	// For Literal: the actual value. strings are interned in the symbol table
+	std::variant<std::monostate, int64_t, double, std::string_view> literalValue;
 
 	// For Variable: reference to the variable
 	VariableReference *variable{};
@@ -36,16 +45,23 @@ struct Expression {
 	// For Pending: the pattern reference (used during resolution)
 	PatternReference *patternReference{};
 
-	// For IntrinsicCall: the intrinsic name
-	std::string intrinsicName;
+	// Arguments (for PatternCall and IntrinsicCall). most calls have one or two
+	SmallVector<Expression *, 2> arguments;
 
-	// Arguments (for PatternCall and IntrinsicCall)
-	std::vector<Expression *> arguments;
+	// For PatternCall: the parameters of the matched pattern in order, with their arguments (set by bindVariables)
+	std::span<ParameterBinding> parameterBindings;
+
+	// make this a string Literal
+	void setString(SymbolTable &symbols, std::string_view text) {
+		kind = Kind::Literal;
+		symbol = symbols.intern(text);
+		literalValue = std::string_view(symbols.text(symbol));
+	}
 };
 
 // Utility: Sort expression arguments by their source position
-inline std::vector<Expression *> sortArgumentsByPosition(const std::vector<Expression *> &args) {
-	std::vector<Expression *> sortedArgs = args;
+inline std::vector<Expression *> sortArgumentsByPosition(std::span<Expression *const> args) {
+	std::vector<Expression *> sortedArgs(args.begin(), args.end());
 	std::sort(sortedArgs.begin(), sortedArgs.end(), [](Expression *a, Expression *b) {
 		return a->range.start() < b->range.start();
 	});
@@ -0,0 +1,52 @@
+#include "intrinsic.h"
+#include <iterator>
+
+using Id = Intrinsic::Id;
+using Result = Intrinsic::Result;
+
+// indexed by id
+static constexpr Intrinsic intrinsics[] = {
+	{"", 0, Result::Other},
+	{"add", 2, Result::Operands},
+	{"subtract", 2, Result::Operands},
+	{"multiply", 2, Result::Operands},
+	{"divide", 2, Result::Operands},
+	{"modulo", 2, Result::Operands},
+	{"less than", 2, Result::Bool},
+	{"less than or equal", 2, Result::Bool},
+	{"greater than", 2, Result::Bool},
+	{"greater than or equal", 2, Result::Bool},
+	{"equal", 2, Result::Bool},
+	{"not equal", 2, Result::Bool},
+	{"and", 2, Result::Bool},
+	{"or", 2, Result::Bool},
+	{"not", 1, Result::Bool},
+	{"negate", 1, Result::Operands},
+	{"address of", 1, Result::Other},
+	{"dereference", 1, Result::Other},
+	{"store at", 3, Result::Void},
+	{"load at", 2, Result::Other},
+	{"store", 2, Result::Void},
+	{"return", 0, Result::Other},
+	{"call", 3, Result::Other},
+	{"cast", 2, Result::Other},
+	{"construct", 1, Result::Other},
+	{"property", 2, Result::Other},
+	{"loop while", 1, Result::Void},
+	{"if", 1, Result::Void},
+	{"else if", 1, Result::Void},
+	{"else", 0, Result::Void},
+	{"switch", 1, Result::Void},
+	{"case", 1, Result::Void},
+};
+static_assert(std::size(intrinsics) == (size_t)Id::Count);
+
+Id Intrinsic::find(std::string_view name) {
+	for (size_t index = 1; index < std::size(intrinsics); index++) {
+		if (intrinsics[index].name == name)
+			return (Id)index;
+	}
+	return Id::Unknown;
+}
+
+const Intrinsic &Intrinsic::get(Id id) { return intrinsics[(size_t)id]; }
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+// An operation the compiler implements itself, called as @intrinsic("name", arguments...). The name is resolved to an id
+// once, when the call is parsed, and the later passes switch on the id.
+struct Intrinsic {
+	enum class Id : uint8_t {
+		Unknown,
+		// arithmetic
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Modulo,
+		// comparisons
+		LessThan,
+		LessThanOrEqual,
+		GreaterThan,
+		GreaterThanOrEqual,
+		Equal,
+		NotEqual,
+		And,
+		Or,
+		Not,
+		Negate,
+		AddressOf,
+		Dereference,
+		StoreAt,
+		LoadAt,
+		Store,
+		Return,
+		Call,
+		Cast,
+		Construct,
+		Property,
+		// control flow: the body section of the line is the body
+		LoopWhile,
+		If,
+		ElseIf,
+		Else,
+		Switch,
+		Case,
+		Count
+	};
+	// how the type of a call is found
+	enum class Result : uint8_t {
+		// the type of the operands, promoted to a common type
+		Operands,
+		Bool,
+		Void,
+		// depends on the intrinsic
+		Other
+	};
+
+	std::string_view name;
+	// the arguments a call needs after the name, at least
+	uint8_t argumentCount;
+	Result result;
+
+	// returns Id::Unknown if no intrinsic has the name
+	static Id find(std::string_view name);
+	static const Intrinsic &get(Id id);
+
+	static bool isArithmetic(Id id) { return id >= Id::Add && id <= Id::Modulo; }
+	static bool isPointerArithmetic(Id id) { return id == Id::Add || id == Id::Subtract; }
+	static bool isComparison(Id id) { return id >= Id::LessThan && id <= Id::NotEqual; }
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Character classes recognized by the lexer. A character can belong to multiple classes,
+// so the lookup table stores them as bit flags.
+enum class CharacterClass : uint8_t {
+	// [A-Za-z0-9_], the characters VariableLike pattern elements consist of
+	Word = 1 << 0,
+	// [0-9]
+	Digit = 1 << 1,
+	// ' ', '\t', '\n', '\v', '\f' and '\r'
+	WhiteSpace = 1 << 2,
+};
+
+// classifying a character is a single table load instead of constructing and running a regex
+constexpr std::array<uint8_t, 256> characterClassTable = [] {
+	std::array<uint8_t, 256> table{};
+	for (int character = 'a'; character <= 'z'; character++)
+		table[character] |= (uint8_t)CharacterClass::Word;
+	for (int character = 'A'; character <= 'Z'; character++)
+		table[character] |= (uint8_t)CharacterClass::Word;
+	for (int character = '0'; character <= '9'; character++)
+		table[character] |= (uint8_t)CharacterClass::Word | (uint8_t)CharacterClass::Digit;
+	table['_'] |= (uint8_t)CharacterClass::Word;
+	for (char character : {' ', '\t', '\n', '\v', '\f', '\r'})
+		table[(unsigned char)character] |= (uint8_t)CharacterClass::WhiteSpace;
+	return table;
+}();
+
+inline bool hasCharacterClass(char character, CharacterClass characterClass) {
+	return characterClassTable[(unsigned char)character] & (uint8_t)characterClass;
+}
+
+inline bool isWordCharacter(char character) { return hasCharacterClass(character, CharacterClass::Word); }
+inline bool isDigitCharacter(char character) { return hasCharacterClass(character, CharacterClass::Digit); }
+inline bool isWhiteSpaceCharacter(char character) { return hasCharacterClass(character, CharacterClass::WhiteSpace); }
@@ -0,0 +1,153 @@
+#include "lexer.h"
+#include "characterClass.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// the scanner looks at this many bytes at a time
+constexpr size_t blockSize = 16;
+
+// find the bytes in a block that end a line or change the string / comment state (\n, \r, # and ") and the bytes that
+// aren't whitespace. bit n of each mask corresponds to block[n].
+static void classifyBlock(const char *block, size_t length, uint32_t &specialMask, uint32_t &codeMask) {
+#ifdef __SSE2__
+	if (length == blockSize) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)block);
+		__m128i lineEnds = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')));
+		__m128i markers = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('#')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')));
+		// whitespace is ' ' or '\t' to '\r', which are consecutive
+		__m128i controlOffset = _mm_sub_epi8(bytes, _mm_set1_epi8('\t'));
+		__m128i isControlWhiteSpace = _mm_cmpeq_epi8(_mm_min_epu8(controlOffset, _mm_set1_epi8('\r' - '\t')), controlOffset);
+		__m128i whiteSpace = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), isControlWhiteSpace);
+		specialMask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(lineEnds, markers));
+		codeMask = ~(uint32_t)_mm_movemask_epi8(whiteSpace) & 0xffff;
+		return;
+	}
+#endif
+	specialMask = 0;
+	codeMask = 0;
+	for (size_t index = 0; index < length; index++) {
+		char character = block[index];
+		if (character == '\n' || character == '\r' || character == '#' || character == '"')
+			specialMask |= 1u << index;
+		if (!isWhiteSpaceCharacter(character))
+			codeMask |= 1u << index;
+	}
+}
+
+std::vector<LineScan> scanLines(std::string_view text) {
+	std::vector<LineScan> lines;
+	size_t lineStart = 0;
+	// the range of non-whitespace code in the current line
+	size_t codeStart = 0;
+	size_t codeEnd = 0;
+	bool foundCode = false;
+	bool inString = false;
+	bool inComment = false;
+	// everything before this has been scanned. can be past the current block after a \r\n crossing it
+	size_t position = 0;
+
+	auto addCode = [&](size_t start, size_t end) {
+		if (!foundCode) {
+			codeStart = start;
+			foundCode = true;
+		}
+		codeEnd = end;
+	};
+	auto endLine = [&](size_t end) {
+		lines.push_back({text.substr(lineStart, end - lineStart), foundCode ? codeStart - lineStart : 0,
+						 foundCode ? codeEnd - lineStart : 0});
+		lineStart = end;
+		foundCode = inString = inComment = false;
+	};
+
+	for (size_t blockStart = 0; blockStart < text.size(); blockStart += blockSize) {
+		size_t blockLength = std::min(blockSize, text.size() - blockStart);
+		size_t blockEnd = blockStart + blockLength;
+		uint32_t specialMask;
+		uint32_t codeMask;
+		classifyBlock(text.data() + blockStart, blockLength, specialMask, codeMask);
+
+		while (position < blockEnd) {
+			// everything between position and the next special byte is plain code or whitespace
+			uint32_t remainingSpecials = specialMask & ~((1u << (position - blockStart)) - 1);
+			size_t segmentEnd = remainingSpecials ? blockStart + std::countr_zero(remainingSpecials) : blockEnd;
+			if (!inComment) {
+				uint32_t segmentCode = (codeMask >> (position - blockStart)) & ((1u << (segmentEnd - position)) - 1);
+				if (segmentCode)
+					addCode(position + std::countr_zero(segmentCode), position + std::bit_width(segmentCode));
+			}
+			if (!remainingSpecials) {
+				position = blockEnd;
+				break;
+			}
+
+			position = segmentEnd + 1;
+			switch (text[segmentEnd]) {
+			case '\r':
+				if (position < text.size() && text[position] == '\n')
+					position++;
+				endLine(position);
+				break;
+			case '\n':
+				endLine(position);
+				break;
+			case '#':
+				if (inString)
+					addCode(segmentEnd, position);
+				else
+					inComment = true;
+				break;
+			case '"':
+				if (!inComment) {
+					addCode(segmentEnd, position);
+					if (segmentEnd == lineStart || text[segmentEnd - 1] != '\\')
+						inString = !inString;
+				}
+				break;
+			}
+		}
+	}
+	if (lineStart < text.size())
+		endLine(text.size());
+	return lines;
+}
+
+std::vector<PatternToken> tokenizePattern(std::string_view pattern) {
+	std::vector<PatternToken> tokens;
+	auto skip = [&pattern](size_t index, CharacterClass characterClass) {
+		while (index < pattern.size() && hasCharacterClass(pattern[index], characterClass))
+			index++;
+		return index;
+	};
+
+	size_t index = 0;
+	while (index < pattern.size()) {
+		char character = pattern[index];
+		if (isWhiteSpaceCharacter(character)) {
+			size_t end = skip(index, CharacterClass::WhiteSpace);
+			tokens.push_back({PatternToken::Type::WhiteSpace, index, end});
+			index = end;
+		} else if (isWordCharacter(character)) {
+			// a number literal is a whole word of digits, optionally followed by '.' and another whole word of digits
+			size_t wordEnd = skip(index, CharacterClass::Word);
+			if (skip(index, CharacterClass::Digit) == wordEnd) {
+				size_t end = wordEnd;
+				if (wordEnd + 1 < pattern.size() && pattern[wordEnd] == '.' && isDigitCharacter(pattern[wordEnd + 1])) {
+					size_t fractionEnd = skip(wordEnd + 1, CharacterClass::Word);
+					if (skip(wordEnd + 1, CharacterClass::Digit) == fractionEnd)
+						end = fractionEnd;
+				}
+				tokens.push_back({PatternToken::Type::Number, index, end});
+				wordEnd = end;
+			}
+			index = wordEnd;
+		} else {
+			index++;
+		}
+	}
+	return tokens;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "lineScan.h"
+#include "patternToken.h"
+#include <string_view>
+#include <vector>
+
+// Split a source file into lines in a single pass. For each line, skips the comment (a # that's not inside a string
+// literal) and finds the indentation and right-trimmed length of the code before it.
+// Lines end at \r\n, \r or \n; a trailing line without terminator is only returned when it's not empty.
+std::vector<LineScan> scanLines(std::string_view text);
+
+// Split a pattern into number literal and whitespace tokens in a single pass, ordered by position.
+std::vector<PatternToken> tokenizePattern(std::string_view pattern);
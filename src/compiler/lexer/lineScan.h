@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// The layout of a single source line, found by scanLines in one pass over the file.
+struct LineScan {
+	// the full line, including its terminator
+	std::string_view line{};
+	// the length of the leading whitespace (0 for lines without code)
+	size_t indentLength{};
+	// the length of the line without its comment and trailing whitespace
+	size_t trimmedLength{};
+};
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+
+// A span of a pattern that needs special treatment before matching
+struct PatternToken {
+	enum class Type {
+		// \b\d+(?:\.\d+)?\b, replaced by an argument
+		Number,
+		// a run of whitespace, trimmed or normalized to a single space
+		WhiteSpace
+	};
+	Type type;
+	size_t start;
+	size_t end;
+};
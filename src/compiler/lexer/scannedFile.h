@@ -0,0 +1,13 @@
+#pragma once
+#include "lineScan.h"
+#include <vector>
+
+namespace lsp {
+struct SourceFile;
+}
+// A source file which was read and split into lines, before its lines are added to the code lines.
+struct ScannedFile {
+	// nullptr if the file couldn't be read
+	lsp::SourceFile *sourceFile{};
+	std::vector<LineScan> lineScans;
+};
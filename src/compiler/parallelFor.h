@@ -0,0 +1,28 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Call body(worker, index) for each index below count, on up to workerCount threads, and wait until all calls are done.
+// worker is below workerCount and no two threads use the same worker at once, so it can pick per-thread scratch data.
+// indices are handed out one at a time, so a slow item doesn't hold up the items after it.
+template <typename Body> void parallelFor(size_t count, size_t workerCount, Body &&body) {
+	workerCount = std::min(workerCount, count);
+	if (workerCount <= 1) {
+		for (size_t index = 0; index < count; index++)
+			body(0, index);
+		return;
+	}
+	std::atomic<size_t> nextIndex{0};
+	auto work = [&](size_t worker) {
+		for (size_t index = nextIndex++; index < count; index = nextIndex++)
+			body(worker, index);
+	};
+	std::vector<std::jthread> threads;
+	for (size_t worker = 1; worker < workerCount; worker++)
+		threads.emplace_back(work, worker);
+	// this thread is worker 0. the other threads are joined when they're destroyed
+	work(0);
+}
@@ -0,0 +1,139 @@
+#include "compiler.h"
+#include "lexer.h"
+#include "lsp/fileSystem.h"
+#include "lsp/sourceFile.h"
+#include "parallelFor.h"
+#include "patternDetection.h"
+#include "scannedFile.h"
+#include <algorithm>
+using namespace std::literals;
+
+// Read and split the file and all files it imports on the worker threads. The imports of a file are only known once
+// it's scanned, so the files are scanned one import depth at a time.
+static std::unordered_map<std::string, ScannedFile> scanSourceFiles(const std::string &path, ParseContext &context) {
+	// starting a thread costs about as much as scanning a few files
+	constexpr size_t minimumFilesPerWorker = 4;
+	std::unordered_map<std::string, ScannedFile> scannedFiles;
+	std::vector<std::string> paths{path};
+	std::vector<ScannedFile> depthFiles;
+	while (!paths.empty()) {
+		depthFiles.assign(paths.size(), {});
+		size_t workerCount = std::min<size_t>(context.jobCount(), paths.size() / minimumFilesPerWorker);
+		parallelFor(paths.size(), workerCount, [&](size_t, size_t index) {
+			ScannedFile &file = depthFiles[index];
+			file.sourceFile = context.fileSystem->getFile(paths[index]);
+			if (file.sourceFile)
+				file.lineScans = scanLines(file.sourceFile->getText());
+		});
+		// the files imported by this depth which weren't scanned yet are the next depth
+		std::vector<std::string> importedPaths;
+		auto isNew = [&](const std::string &importPath) {
+			return !scannedFiles.contains(importPath) && std::ranges::find(paths, importPath) == paths.end() &&
+				   std::ranges::find(importedPaths, importPath) == importedPaths.end();
+		};
+		for (const ScannedFile &file : depthFiles) {
+			for (const LineScan &scan : file.lineScans) {
+				std::string_view rightTrimmedText = scan.line.substr(0, scan.trimmedLength);
+				if (!rightTrimmedText.starts_with("import "))
+					continue;
+				std::string importPath(rightTrimmedText.substr("import "sv.length()));
+				if (isNew(importPath))
+					importedPaths.push_back(std::move(importPath));
+			}
+		}
+		for (size_t index = 0; index < paths.size(); index++)
+			scannedFiles.emplace(std::move(paths[index]), std::move(depthFiles[index]));
+		paths = std::move(importedPaths);
+	}
+	return scannedFiles;
+}
+
+// Add the lines of a scanned file to the code lines, replacing each import statement with the lines of the imported file
+static bool addSourceLines(
+	const std::string &path, ParseContext &context, const std::unordered_map<std::string, ScannedFile> &scannedFiles
+) {
+	// Check if already imported (circular import protection)
+	if (context.importedFiles.contains(path)) {
+		return true; // Already processed, skip
+	}
+
+	const ScannedFile &scannedFile = scannedFiles.at(path);
+	lsp::SourceFile *sourceFile = scannedFile.sourceFile;
+	if (!sourceFile) {
+		if (context.importedFiles.empty()) {
+			// If this is the main file, report error
+			context.diagnostics.push_back(Diagnostic(Diagnostic::Level::Error, "couldn't import main file: " + path, Range()));
+		}
+		return false;
+	}
+
+	if (context.importedFiles.empty())
+		context.mainFile = sourceFile;
+	context.importedFiles[path] = sourceFile;
+
+	const std::vector<LineScan> &lineScans = scannedFile.lineScans;
+	for (int sourceFileLineIndex = 0; sourceFileLineIndex < (int)lineScans.size(); sourceFileLineIndex++) {
+		const LineScan &scan = lineScans[sourceFileLineIndex];
+		CodeLine *line = context.arena.create<CodeLine>(scan.line, sourceFile);
+		line->sourceFileLineIndex = sourceFileLineIndex;
+		line->rightTrimmedText = scan.line.substr(0, scan.trimmedLength);
+		line->indentation = scan.line.substr(0, scan.indentLength);
+
+		// check if the line is an import statement
+		if (line->rightTrimmedText.starts_with("import ")) {
+			// recursively import the file, replacing this line with the imported content
+			std::string_view importPath = line->rightTrimmedText.substr("import "sv.length());
+			if (!addSourceLines((std::string)importPath, context, scannedFiles)) {
+				context.diagnostics.push_back(Diagnostic(
+					Diagnostic::Level::Error, "failed to import source file: " + (std::string)importPath,
+					Range(line, "import "sv.length(), line->rightTrimmedText.length())
+				));
+				return false;
+			}
+			continue;
+		}
+		line->mergedLineIndex = context.codeLines.size();
+		context.codeLines.push_back(line);
+	}
+	return true;
+}
+
+bool importSourceFile(const std::string &path, ParseContext &context) {
+	std::unordered_map<std::string, ScannedFile> scannedFiles = scanSourceFiles(path, context);
+	return addSourceLines(path, context, scannedFiles);
+}
+
+// Detect the expressions of the lines on the worker threads. The calling thread creates its expressions in the context
+// arena and the other workers in their own, which the context takes over afterwards. The detections are then applied in
+// line order, so the pattern references, symbols and diagnostics don't depend on the thread count.
+void detectExpressions(ParseContext &context) {
+	// starting a thread costs about as much as detecting a few hundred lines
+	constexpr size_t minimumLinesPerWorker = 256;
+	std::vector<PatternDetection> &detections = context.patternDetections;
+	size_t workerCount = std::min<size_t>(context.jobCount(), detections.size() / minimumLinesPerWorker);
+	std::vector<Arena> workerArenas(std::max<size_t>(workerCount, 1) - 1);
+	parallelFor(detections.size(), workerCount, [&](size_t worker, size_t index) {
+		detections[index].arena = worker == 0 ? &context.arena : &workerArenas[worker - 1];
+		detectPatterns(detections[index]);
+	});
+	for (Arena &workerArena : workerArenas)
+		context.arena.adopt(workerArena);
+
+	std::vector<Diagnostic> diagnostics;
+	size_t contextDiagnosticIndex = 0;
+	for (PatternDetection &detection : detections) {
+		for (; contextDiagnosticIndex < detection.diagnosticIndex; contextDiagnosticIndex++)
+			diagnostics.push_back(std::move(context.diagnostics[contextDiagnosticIndex]));
+		diagnostics.insert(diagnostics.end(), detection.diagnostics.begin(), detection.diagnostics.end());
+		for (auto &[expression, text] : detection.stringLiterals)
+			expression->setString(context.symbols, text);
+		detection.line->expression = detection.expression;
+		// a line which failed to detect keeps the references found before the error
+		for (PatternReference *reference : detection.patternReferences)
+			detection.section->addPatternReference(reference);
+	}
+	for (; contextDiagnosticIndex < context.diagnostics.size(); contextDiagnosticIndex++)
+		diagnostics.push_back(std::move(context.diagnostics[contextDiagnosticIndex]));
+	context.diagnostics = std::move(diagnostics);
+	detections.clear();
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+struct Expression;
+// A parameter of the pattern a call matched, with the argument the call passes to it
+struct ParameterBinding {
+	// the symbol of the parameter name
+	uint32_t name;
+	Expression *argument;
+	// the argument is a variable, which can be passed by reference or be bound to a macro argument.
+	// other arguments are temporaries
+	bool isVariable;
+};
@@ -1,6 +1,7 @@
 #include "parseContext.h"
-#include "matchProgress.h"
+#include <algorithm>
 #include <iostream>
+#include <thread>
 
 void ParseContext::printDiagnostics() {
 	for (Diagnostic d : diagnostics) {
@@ -8,17 +9,17 @@ void ParseContext::printDiagnostics() {
 	}
 }
 
-PatternMatch *ParseContext::match(PatternReference *reference) {
-	MatchProgress progress = MatchProgress(this, reference);
-	std::vector<MatchProgress> queue = {progress};
-	while (queue.size()) {
-		MatchProgress &currentProgress = queue.back();
-		std::vector<MatchProgress> nextSteps = currentProgress.step();
-		if (currentProgress.isComplete()) {
-			return new PatternMatch(currentProgress.match);
-		}
-		queue.pop_back();
-		queue.insert(queue.end(), nextSteps.begin(), nextSteps.end());
-	}
-	return nullptr;
+unsigned ParseContext::jobCount() const {
+	return options.jobs > 0 ? (unsigned)options.jobs : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+Type ParseContext::typeOf(const Expression *expression) const {
+	return currentExpansion ? currentExpansion->typeOf(expression) : expression->type;
+}
+
+Expansion *ParseContext::calleeOf(const Expression *call) const {
+	if (currentExpansion)
+		return currentExpansion->calleeOf(call);
+	auto it = callExpansions.find(call);
+	return it != callExpansions.end() ? it->second : nullptr;
 }
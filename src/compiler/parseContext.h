@@ -1,10 +1,16 @@
 #pragma once
+#include "arena.h"
 #include "codeLine.h"
 #include "diagnostic.h"
+#include "effectiveTypes.h"
 #include "lsp/fileSystem.h"
+#include "patternDetection.h"
 #include "patternMatch.h"
 #include "patternTreeNode.h"
+#include "scopedBindings.h"
 #include "section.h"
+#include "symbolTable.h"
+#include "typeDependencies.h"
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
@@ -21,15 +27,28 @@ class BasicBlock;
 } // namespace llvm
 
 struct ParseContext {
+	// owns every front-end node (code lines, sections, expressions, references, pattern trees, ...).
+	// declared first, so it's destroyed after everything which points into it.
+	Arena arena;
+
 	struct Options {
 		std::string inputPath;
 		std::string outputPath;
 		bool emitLLVM = false;
+		// JIT compile the program and run it in this process instead of writing an executable (--run)
+		bool run = false;
 		int optimizationLevel = 0; // 0-3, corresponds to -O0 through -O3
+		// the CPU and target features the code is generated for (-mcpu=, -march=, -mattr=). "native" is this machine.
+		// an empty CPU is a generic one of the architecture, or this machine with --run
+		std::string targetCpu;
+		std::string targetFeatures;
 		// Maximum iterations for resolving pattern references and sections.
 		// Pattern resolution is iterative: each pass resolves patterns that become unambiguous
 		// when other patterns are resolved. 256 iterations is sufficient for deeply nested patterns.
 		int maxResolutionIterations = 256;
+		// threads to read files, detect expressions, match pattern references and generate machine code on (-j). 0 uses
+		// one per hardware thread
+		int jobs = 0;
 	} options;
 
 	// LLVM
@@ -41,18 +60,28 @@ struct ParseContext {
 	llvm::LLVMContext *llvmContext{};
 	llvm::Module *llvmModule{};
 	llvm::IRBuilderBase *llvmBuilder{};
+	// the value main returned when the program was run in this process
+	int exitCode{};
 
 	// Temporary codegen bindings (pushed/popped during generation)
 	// Pattern parameter bindings: maps variable name to LLVM value (for function parameters)
-	std::unordered_map<std::string, llvm::Value *> patternBindings;
+	ScopedBindings<llvm::Value *> patternBindings;
 	// Pattern parameter types: maps parameter name to its type (for monomorphized functions)
-	std::unordered_map<std::string, Type> patternParamTypes;
+	ScopedBindings<Type> patternParamTypes;
 	// Macro expression bindings: maps variable name to Expression* (for macro expansion)
-	std::unordered_map<std::string, Expression *> macroExpressionBindings;
+	ScopedBindings<Expression *> macroExpressionBindings;
+	// the effective types of the expressions generated with the current bindings
+	EffectiveTypes effectiveTypes;
 	// Current body section for macro expansion (used by loop intrinsics to store loop info)
 	Section *currentBodySection{};
 	// Current instantiation being inferred (set during non-macro function body inference)
 	Instantiation *currentInstantiation{};
+	// Which code lines read which types (set during type inference)
+	TypeDependencies *typeDependencies{};
+	// Expansion whose body is being inferred or generated. the types of its body expressions are kept in it
+	Expansion *currentExpansion{};
+	// the expansions used by the calls outside of any expansion
+	std::unordered_map<const Expression *, Expansion *> callExpansions;
 	// Current switch statement being built (set by "switch" intrinsic, used by "case" intrinsic)
 	llvm::SwitchInst *currentSwitchInst{};
 	llvm::BasicBlock *currentSwitchExitBlock{};
@@ -60,24 +89,37 @@ struct ParseContext {
 	// Libraries required for linking (collected from @intrinsic("call", ...) calls)
 	std::unordered_set<std::string> requiredLibraries;
 
-	// String constants (maps string content to global variable)
-	std::unordered_map<std::string, llvm::GlobalVariable *> stringConstants;
+	// String constants (maps string content to global variable). the keys point into symbols or at C string literals
+	std::unordered_map<std::string_view, llvm::GlobalVariable *> stringConstants;
 
 	// imported source files by path (also prevents circular imports)
 	std::unordered_map<std::string, lsp::SourceFile *> importedFiles;
+	// the file which was compiled, which imported the others
+	lsp::SourceFile *mainFile{};
 	// all code lines in 'chronological' order: imported code lines get put before the import statement
 	std::vector<CodeLine *> codeLines;
 	std::vector<Diagnostic> diagnostics;
 	Section *mainSection{};
+	// the lines whose expressions analyzeSections detects after building the sections
+	std::vector<PatternDetection> patternDetections;
 	// for each section type, we store a tree with patterns, leading to sections.
 	// we use global pattern trees which can store multiple end nodes (exclusion based).
 	// this is to prevent having to search all pattern trees of every scope, or merging trees per scope.
-	PatternTreeNode *patternTrees[(int)SectionType::Count];
+	PatternTreeNode *patternTrees[(int)SectionType::Count]{};
+	// changes whenever a definition is added to the pattern trees, so matchers know when their cached results are stale
+	uint32_t patternTreeGeneration{};
+	// the text of all pattern elements, interned
+	SymbolTable symbols;
 	// variable references that don't correspond to any pattern element
 	std::unordered_map<std::string, std::list<VariableReference *>> unresolvedVariableReferences;
 	// prohibit copies
 	ParseContext(ParseContext &) = delete;
 	ParseContext() {}
 	void printDiagnostics();
-	PatternMatch *match(PatternReference *reference);
+	// the number of threads to work on, see options.jobs
+	unsigned jobCount() const;
+	// the type of an expression in the current expansion
+	Type typeOf(const Expression *expression) const;
+	// the expansion a call in the current expansion uses. returns nullptr if it's unknown
+	Expansion *calleeOf(const Expression *call) const;
 };
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+struct PatternTreeNode;
+// a step of a match in the PatternMatcher cache. unlike MatchEvents, the steps don't refer to the reference they were
+// found for, so they can be applied to every reference with the same pattern. a match is stored as a Match step, the
+// steps of the match in order and an End step. sub-matches are stored in place.
+struct CachedMatchStep {
+	enum class Kind : uint8_t {
+		// the start of a match
+		Match,
+		// the end of a match
+		End,
+		NodePassed,
+		Variable,
+		Word,
+		Argument,
+	};
+	Kind kind;
+	// Variable, Word: the source element index. Argument: the argument index
+	uint32_t index{};
+	// Match: where the match starts in the pattern. Variable, Word: the position of the element in the pattern
+	size_t patternPos{};
+	// Match: where the match ends in the pattern
+	size_t patternEndPos{};
+	// Match: the end node. NodePassed: the node
+	PatternTreeNode *node{};
+};
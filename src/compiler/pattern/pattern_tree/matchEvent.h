@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+struct PatternTreeNode;
+// a step of a match which adds data to the resulting PatternMatch. the events of a match form a linked list from newest
+// to oldest, so progresses branching off the same match share their common events.
+struct MatchEvent {
+	enum class Kind : uint8_t {
+		// a node was passed (PatternMatch::nodesPassed)
+		NodePassed,
+		// a VariableLike source element was used as argument (PatternMatch::discoveredVariables)
+		Variable,
+		// a VariableLike source element was captured as word (PatternMatch::discoveredWords)
+		Word,
+		// an argument of the reference expression was used (PatternMatch::arguments)
+		Argument,
+		// a sub-match finished (PatternMatch::subMatches)
+		SubMatch,
+	};
+	Kind kind;
+	uint32_t previous;
+	// Variable, Word: the source element index. Argument: the argument index. SubMatch: the finished progress index
+	uint32_t index{};
+	// Variable, Word: the position of the element in the pattern
+	size_t patternPos{};
+	// NodePassed: the node
+	PatternTreeNode *node{};
+};
@@ -1,10 +1,10 @@
 #include "patternElement.h"
+#include "characterClass.h"
 #include "transformedPattern.h"
 #include <cassert>
-#include <regex>
 using namespace std::literals;
 
-std::vector<PatternElement> getPatternElements(std::string_view patternString) {
+std::vector<PatternElement> getPatternElements(SymbolTable &symbols, std::string_view patternString) {
 	std::vector<PatternElement> elements{};
 
 	if (patternString.empty())
@@ -15,25 +15,29 @@ std::vector<PatternElement> getPatternElements(std::string_view patternString) {
 	const char *currentStart = nullptr;
 	const char *it;
 	for (it = patternString.begin(); it != patternString.end(); it++) {
-		PatternElement::Type newType = *it == argumentChar								? PatternElement::Type::Variable
-									   : std::regex_match(""s + *it, std::regex("\\w")) ? PatternElement::Type::VariableLike
-																						: PatternElement::Type::Other;
+		PatternElement::Type newType = *it == argumentChar		? PatternElement::Type::Variable
+									   : isWordCharacter(*it) ? PatternElement::Type::VariableLike
+															  : PatternElement::Type::Other;
 		if (newType != currentType) {
 			if (currentStart) {
-				elements.push_back(
-					PatternElement(currentType, std::string(currentStart, it), currentStart - patternString.begin())
-				);
+				std::string_view text(currentStart, it);
+				elements.push_back(PatternElement(
+					currentType, std::string(text), currentStart - patternString.begin(), symbols.intern(text)
+				));
 			}
 			currentStart = it;
 			currentType = newType;
 		}
 	}
-	elements.push_back(PatternElement(currentType, std::string(currentStart, it), currentStart - patternString.begin()));
+	std::string_view text(currentStart, it);
+	elements.push_back(
+		PatternElement(currentType, std::string(text), currentStart - patternString.begin(), symbols.intern(text))
+	);
 
 	return elements;
 }
 
-std::vector<PatternElement> parsePatternElements(std::string_view patternString, size_t offset) {
+std::vector<PatternElement> parsePatternElements(SymbolTable &symbols, std::string_view patternString, size_t offset) {
 	std::vector<PatternElement> result;
 	size_t pos = 0;
 
@@ -45,7 +49,7 @@ std::vector<PatternElement> parsePatternElements(std::string_view patternString,
 
 		if (bracketStart == std::string_view::npos) {
 			// no more brackets - parse remaining plain text
-			auto plain = getPatternElements(patternString.substr(pos));
+			auto plain = getPatternElements(symbols, patternString.substr(pos));
 			for (auto &elem : plain)
 				elem.startPos += pos + offset;
 			result.insert(result.end(), plain.begin(), plain.end());
@@ -54,7 +58,7 @@ std::vector<PatternElement> parsePatternElements(std::string_view patternString,
 
 		// parse plain text before the bracket
 		if (bracketStart > pos) {
-			auto plain = getPatternElements(patternString.substr(pos, bracketStart - pos));
+			auto plain = getPatternElements(symbols, patternString.substr(pos, bracketStart - pos));
 			for (auto &elem : plain)
 				elem.startPos += pos + offset;
 			result.insert(result.end(), plain.begin(), plain.end());
@@ -86,7 +90,7 @@ std::vector<PatternElement> parsePatternElements(std::string_view patternString,
 			std::string_view captureType = content.substr(0, colonPos);
 			std::string name(content.substr(colonPos + 1));
 			if (captureType == "word") {
-				result.push_back(PatternElement(PatternElement::Type::Word, name, bracketStart + offset));
+				result.push_back(PatternElement(PatternElement::Type::Word, name, bracketStart + offset, symbols.intern(name)));
 			} else {
 				assert(false && "Unknown capture type");
 			}
@@ -113,7 +117,7 @@ std::vector<PatternElement> parsePatternElements(std::string_view patternString,
 			PatternElement choice(PatternElement::Type::Choice, {}, bracketStart + offset);
 			size_t altOffset = bracketStart + 1 + offset;
 			for (auto &part : parts) {
-				choice.alternatives.push_back(parsePatternElements(part, altOffset));
+				choice.alternatives.push_back(parsePatternElements(symbols, part, altOffset));
 				altOffset += part.size() + 1; // +1 for '|'
 			}
 			// if the choice has an empty alternative and is followed by a space,
@@ -129,7 +133,7 @@ std::vector<PatternElement> parsePatternElements(std::string_view patternString,
 			if (hasEmptyAlternative && i < patternString.size() && patternString[i] == ' ') {
 				for (auto &alt : choice.alternatives) {
 					if (!alt.empty()) {
-						alt.push_back(PatternElement(PatternElement::Type::Other, " ", i + offset));
+						alt.push_back(PatternElement(PatternElement::Type::Other, " ", i + offset, symbols.intern(" ")));
 					}
 				}
 				i++; // skip the space in the main sequence
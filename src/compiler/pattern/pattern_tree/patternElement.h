@@ -1,4 +1,5 @@
 #pragma once
+#include "symbolTable.h"
 #include <string>
 #include <vector>
 struct PatternElement {
@@ -20,19 +21,21 @@ struct PatternElement {
 	Type type;
 	// for example: 'the'
 	std::string text;
+	// the interned text
+	uint32_t symbol = noSymbol;
 	// position relative to pattern start
 	size_t startPos{};
 	// for Choice type: each alternative is a sequence of elements
 	std::vector<std::vector<PatternElement>> alternatives;
-	PatternElement(Type type, const std::string &text = {}, size_t startPos = {})
-		: type(type), text(text), startPos(startPos) {}
+	PatternElement(Type type, const std::string &text = {}, size_t startPos = {}, uint32_t symbol = noSymbol)
+		: type(type), text(text), symbol(symbol), startPos(startPos) {}
 };
 
-// Parse plain text (no brackets) into pattern elements
-std::vector<PatternElement> getPatternElements(std::string_view patternString);
+// Parse plain text (no brackets) into pattern elements, interning their text
+std::vector<PatternElement> getPatternElements(SymbolTable &symbols, std::string_view patternString);
 
 // Parse pattern text with [bracket|alternatives] into elements (calls getPatternElements for plain segments)
-std::vector<PatternElement> parsePatternElements(std::string_view patternString, size_t offset = 0);
+std::vector<PatternElement> parsePatternElements(SymbolTable &symbols, std::string_view patternString, size_t offset = 0);
 
 // Visit all leaf (non-Choice) elements recursively, including inside Choice alternatives
 template <typename F> void forEachLeafElement(std::vector<PatternElement> &elements, F &&callback) {
@@ -2,6 +2,8 @@
 #include "patternTreeNode.h"
 #include "variableMatch.h"
 
+struct Expression;
+
 struct PatternMatch {
 	PatternTreeNode *matchedEndNode;
 	size_t lineStartPos;
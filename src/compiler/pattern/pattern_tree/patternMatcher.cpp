@@ -0,0 +1,351 @@
+#include "patternMatcher.h"
+#include "parseContext.h"
+#include "patternReference.h"
+#include <algorithm>
+
+std::optional<PatternMatch> PatternMatcher::find(
+	const ParseContext &context, PatternReference *reference, std::vector<PatternTreeSlot> *emptySlots
+) {
+	this->context = &context;
+	this->reference = reference;
+	this->emptySlots = emptySlots;
+	if (cacheGeneration != context.patternTreeGeneration) {
+		cache.clear();
+		cachedSteps.clear();
+		cacheGeneration = context.patternTreeGeneration;
+	}
+	buildCacheKey();
+	auto cached = cache.find(cacheKey);
+	if (cached != cache.end() && (cached->second != noMatchIndex || !emptySlots)) {
+		if (cached->second == noMatchIndex)
+			return std::nullopt;
+		size_t stepIndex = cached->second;
+		return applyMatch(stepIndex);
+	}
+
+	progresses.clear();
+	events.clear();
+	searchStack.clear();
+	size_t elementCount = reference->patternElements.size();
+	subMatchMemos.assign(elementCount, {});
+	finishedEnds.assign((elementCount + 1) * (elementCount + 1), false);
+	currentSearch = elementCount;
+
+	MatchProgress start{};
+	start.type = reference->patternType;
+	start.rootNode = context.patternTrees[(int)start.type];
+	start.currentNode = start.rootNode;
+	pushProgress(start);
+
+	uint32_t endIndex = search(0);
+	if (endIndex == noMatchIndex) {
+		// the empty slots aren't cached, so a failure which looked for them is searched again
+		if (!emptySlots)
+			cache.emplace(cacheKey, noMatchIndex);
+		return std::nullopt;
+	}
+	size_t stepIndex = cachedSteps.size();
+	cacheMatch(endIndex);
+	cache.emplace(cacheKey, (uint32_t)stepIndex);
+	return applyMatch(stepIndex);
+}
+
+uint32_t PatternMatcher::search(size_t stackBase) {
+	while (searchStack.size() > stackBase) {
+		uint32_t entry = searchStack.back();
+		searchStack.pop_back();
+		uint32_t progressIndex = entry & progressIndexMask;
+		if (entry & substituteFlag) {
+			substitute(progressIndex);
+		} else if (entry & finishedFlag) {
+			SubMatchMemo &memo = subMatchMemos[currentSearch];
+			memo.lastSubMatch = addEvent({MatchEvent::Kind::SubMatch, memo.lastSubMatch, progressIndex});
+		} else {
+			const MatchProgress &progress = progresses[progressIndex];
+			if (progress.currentNode->matchingDefinition && !progress.isSubMatch &&
+				progress.sourceElementIndex == reference->patternElements.size()) {
+				// end node found
+				return progressIndex;
+			}
+			step(progressIndex);
+		}
+	}
+	return noMatchIndex;
+}
+
+void PatternMatcher::step(uint32_t progressIndex) {
+	// copy, since adding progresses can move the stored one
+	const MatchProgress progress = progresses[progressIndex];
+
+	if (!progress.currentNode->matchingDefinition) {
+		// a definition ending here could finish a match
+		addEmptySlot({progress.currentNode, PatternTreeSlot::Kind::Definition});
+	} else if (progress.canBeSubstitute()) {
+		// this might be a submatch of a higher level match.
+		// matches ending at the same element continue the same way, so only the first one found is continued
+		size_t elementCount = reference->patternElements.size();
+		std::vector<bool>::reference finished = finishedEnds[currentSearch * (elementCount + 1) + progress.sourceElementIndex];
+		if (!finished) {
+			finished = true;
+			if (progress.isSubMatch) {
+				// there already is a parent match which submatched, possibly for this match
+				//  f.e: '$ + $' in 'set $ to $ + $'
+				// it's continued once all sub-matches from its start are known, in the order they're popped here
+				searchStack.push_back(progressIndex | finishedFlag);
+			}
+			if (progress.canSubstitute() && progress.rootNode->argumentChild) {
+				// this might be the first submatch of a higher level match between parent and this match,
+				// making the current parent the grand parent.
+				// f.e: 'the result' in 'the result = 10'
+				// or: '$ + $' in 'set $ to $ + $ dollars'
+				// set $ to $: grandparent
+				// $ dollars: parent (just discovered)
+				// $ + $: current match (we just finished matching this)
+				MatchProgress newParent = progress;
+				// advance past the argument slot — the completed sub-expression occupies it
+				newParent.currentNode = progress.rootNode->argumentChild;
+				newParent.lastEvent = addNodePassed(noMatchIndex, newParent.currentNode);
+				newParent.type = SectionType::Expression;
+				stepUp(newParent, progressIndex);
+			} else if (progress.canSubstitute()) {
+				addEmptySlot({progress.rootNode, PatternTreeSlot::Kind::Argument});
+			}
+		}
+	}
+	if (progress.sourceElementIndex < reference->patternElements.size()) {
+		const PatternElement &elementToCompare = reference->patternElements[progress.sourceElementIndex];
+		PatternTreeNode *currentNode = progress.currentNode;
+
+		// less priority: arguments
+		if (currentNode->argumentChild) {
+			if (progress.canSubstitute()) {
+				// substitute the following part of the pattern
+				// don't increase sourceElementIndex for the submatch, we need to compare this element in the submatch
+				MatchProgress parent = progress;
+				parent.currentNode = currentNode->argumentChild;
+				parent.lastEvent = addNodePassed(progress.lastEvent, parent.currentNode);
+				searchStack.push_back(addProgress(parent) | substituteFlag);
+			}
+
+			// use an element as argument
+			if (elementToCompare.type != PatternElement::Type::Other) {
+				// variable or potential variable
+				MatchProgress substituteStep = progress;
+				// we continue on the branch that takes an argument now
+				substituteStep.currentNode = currentNode->argumentChild;
+				substituteStep.lastEvent = addNodePassed(progress.lastEvent, substituteStep.currentNode);
+				if (elementToCompare.type == PatternElement::Type::VariableLike) {
+					substituteStep.lastEvent = addEvent(
+						{MatchEvent::Kind::Variable, substituteStep.lastEvent, progress.sourceElementIndex, progress.patternPos}
+					);
+				} else {
+					// argument
+					substituteStep.lastEvent =
+						addEvent({MatchEvent::Kind::Argument, substituteStep.lastEvent, progress.sourceArgumentIndex});
+					substituteStep.sourceArgumentIndex++;
+				}
+				substituteStep.sourceElementIndex++;
+				substituteStep.patternPos += elementToCompare.text.size();
+				pushProgress(substituteStep);
+			}
+		} else {
+			addEmptySlot({currentNode, PatternTreeSlot::Kind::Argument});
+		}
+		// word capture: matches a single VariableLike token as a string literal
+		if (currentNode->wordChild && elementToCompare.type == PatternElement::Type::VariableLike) {
+			MatchProgress wordStep = progress;
+			wordStep.currentNode = currentNode->wordChild;
+			wordStep.lastEvent = addNodePassed(progress.lastEvent, wordStep.currentNode);
+			wordStep.lastEvent =
+				addEvent({MatchEvent::Kind::Word, wordStep.lastEvent, progress.sourceElementIndex, progress.patternPos});
+			wordStep.sourceElementIndex++;
+			wordStep.patternPos += elementToCompare.text.size();
+			pushProgress(wordStep);
+		} else if (elementToCompare.type == PatternElement::Type::VariableLike) {
+			addEmptySlot({currentNode, PatternTreeSlot::Kind::Word});
+		}
+		// most priority: text match
+		if (elementToCompare.type != PatternElement::Type::Variable) {
+			if (PatternTreeNode *literalChild = currentNode->literalChild(elementToCompare.symbol)) {
+				MatchProgress elementStep = progress;
+				elementStep.currentNode = literalChild;
+				elementStep.lastEvent = addNodePassed(progress.lastEvent, elementStep.currentNode);
+				elementStep.sourceElementIndex++;
+				elementStep.patternPos += elementToCompare.text.size();
+				pushProgress(elementStep);
+			} else {
+				addEmptySlot({currentNode, PatternTreeSlot::Kind::Literal, elementToCompare.symbol});
+			}
+		}
+	}
+}
+
+void PatternMatcher::substitute(uint32_t parentIndex) {
+	// copy, since adding progresses can move the stored one
+	const MatchProgress parent = progresses[parentIndex];
+	uint32_t startIndex = parent.sourceElementIndex;
+	if (!subMatchMemos[startIndex].searched) {
+		subMatchMemos[startIndex].searched = true;
+		// the sub-matches only depend on where they start, not on the parent
+		MatchProgress subMatch = parent;
+		subMatch.isSubMatch = true;
+		subMatch.lastEvent = noMatchIndex;
+		subMatch.currentNode = context->patternTrees[(int)SectionType::Expression];
+		subMatch.rootNode = subMatch.currentNode;
+		subMatch.type = SectionType::Expression;
+		subMatch.patternStartPos = parent.patternPos;
+
+		uint32_t outerSearch = currentSearch;
+		currentSearch = startIndex;
+		size_t stackBase = searchStack.size();
+		pushProgress(subMatch);
+		search(stackBase);
+		currentSearch = outerSearch;
+	}
+	// push the newest sub-match first, so the sub-match found first is continued first
+	for (uint32_t eventIndex = subMatchMemos[startIndex].lastSubMatch; eventIndex != noMatchIndex;
+		 eventIndex = events[eventIndex].previous)
+		stepUp(parent, events[eventIndex].index);
+}
+
+void PatternMatcher::stepUp(const MatchProgress &parentProgress, uint32_t finishedIndex) {
+	const MatchProgress &finished = progresses[finishedIndex];
+	MatchProgress next = parentProgress;
+	next.lastEvent = addEvent({MatchEvent::Kind::SubMatch, parentProgress.lastEvent, finishedIndex});
+	// sourceElementIndex stays the same when stepping up, we are already past the last node
+	// (we have compared the last element already, the sourceElementIndex was increased then)
+	next.sourceElementIndex = finished.sourceElementIndex;
+	next.sourceArgumentIndex = finished.sourceArgumentIndex;
+	next.patternPos = finished.patternPos;
+	pushProgress(next);
+}
+
+uint32_t PatternMatcher::addProgress(const MatchProgress &progress) {
+	progresses.push_back(progress);
+	return progresses.size() - 1;
+}
+
+void PatternMatcher::pushProgress(const MatchProgress &progress) {
+	// f.e. a parent continued with a sub-match which isn't followed by an element the parent can take
+	if (canContinue(progress.currentNode, progress.sourceElementIndex))
+		searchStack.push_back(addProgress(progress));
+}
+
+uint32_t PatternMatcher::addEvent(const MatchEvent &event) {
+	events.push_back(event);
+	return events.size() - 1;
+}
+
+uint32_t PatternMatcher::addNodePassed(uint32_t previous, PatternTreeNode *node) {
+	MatchEvent event{MatchEvent::Kind::NodePassed, previous};
+	event.node = node;
+	return addEvent(event);
+}
+
+void PatternMatcher::addEmptySlot(const PatternTreeSlot &slot) {
+	if (emptySlots)
+		emptySlots->push_back(slot);
+}
+
+bool PatternMatcher::canContinue(const PatternTreeNode *node, uint32_t elementIndex) {
+	// a match can end at a definition, or continue as sub-match
+	if (node->matchingDefinition)
+		return true;
+	const std::vector<PatternElement> &elements = reference->patternElements;
+	if (elementIndex < elements.size() && node->canStartWith(elements[elementIndex]))
+		return true;
+	// the slots step would look at. the node has no argument child, or it could start with any element
+	addEmptySlot({node, PatternTreeSlot::Kind::Definition});
+	if (elementIndex < elements.size()) {
+		const PatternElement &element = elements[elementIndex];
+		addEmptySlot({node, PatternTreeSlot::Kind::Argument});
+		if (element.type == PatternElement::Type::VariableLike)
+			addEmptySlot({node, PatternTreeSlot::Kind::Word});
+		if (element.type != PatternElement::Type::Variable)
+			addEmptySlot({node, PatternTreeSlot::Kind::Literal, element.symbol});
+	}
+	return false;
+}
+
+void PatternMatcher::cacheMatch(uint32_t progressIndex) {
+	const MatchProgress &progress = progresses[progressIndex];
+	cachedSteps.push_back(
+		{CachedMatchStep::Kind::Match, 0, progress.patternStartPos, progress.patternPos, progress.currentNode}
+	);
+	// the events link from newest to oldest, so walk them first and cache them from the back
+	size_t chainStart = eventChain.size();
+	for (uint32_t eventIndex = progress.lastEvent; eventIndex != noMatchIndex; eventIndex = events[eventIndex].previous)
+		eventChain.push_back(eventIndex);
+	for (size_t chainIndex = eventChain.size(); chainIndex > chainStart; chainIndex--) {
+		const MatchEvent &event = events[eventChain[chainIndex - 1]];
+		switch (event.kind) {
+		case MatchEvent::Kind::NodePassed:
+			cachedSteps.push_back({CachedMatchStep::Kind::NodePassed, 0, 0, 0, event.node});
+			break;
+		case MatchEvent::Kind::Variable:
+			cachedSteps.push_back({CachedMatchStep::Kind::Variable, event.index, event.patternPos});
+			break;
+		case MatchEvent::Kind::Word:
+			cachedSteps.push_back({CachedMatchStep::Kind::Word, event.index, event.patternPos});
+			break;
+		case MatchEvent::Kind::Argument:
+			cachedSteps.push_back({CachedMatchStep::Kind::Argument, event.index});
+			break;
+		case MatchEvent::Kind::SubMatch:
+			cacheMatch(event.index);
+			break;
+		}
+	}
+	eventChain.resize(chainStart);
+	cachedSteps.push_back({CachedMatchStep::Kind::End});
+}
+
+PatternMatch PatternMatcher::applyMatch(size_t &stepIndex) const {
+	const CachedMatchStep &start = cachedSteps[stepIndex++];
+	PatternMatch match{};
+	match.matchedEndNode = start.node;
+	match.lineStartPos = reference->pattern.getLinePos(start.patternPos);
+	match.lineEndPos = reference->pattern.getLinePos(start.patternEndPos);
+	while (cachedSteps[stepIndex].kind != CachedMatchStep::Kind::End) {
+		const CachedMatchStep &step = cachedSteps[stepIndex];
+		switch (step.kind) {
+		case CachedMatchStep::Kind::Match:
+			// a sub-match, which moves stepIndex past its own steps
+			match.subMatches.push_back(applyMatch(stepIndex));
+			continue;
+		case CachedMatchStep::Kind::NodePassed:
+			match.nodesPassed.push_back(step.node);
+			break;
+		case CachedMatchStep::Kind::Variable:
+		case CachedMatchStep::Kind::Word: {
+			const std::string &text = reference->patternElements[step.index].text;
+			size_t lineStart = reference->pattern.getLinePos(step.patternPos);
+			size_t lineEnd = reference->pattern.getLinePos(step.patternPos + text.size());
+			if (step.kind == CachedMatchStep::Kind::Variable)
+				match.discoveredVariables.push_back({text, lineStart, lineEnd});
+			else
+				match.discoveredWords.push_back({text, lineStart, lineEnd});
+			break;
+		}
+		case CachedMatchStep::Kind::Argument:
+			match.arguments.push_back(reference->expression->arguments[step.index]);
+			break;
+		case CachedMatchStep::Kind::End:
+			break;
+		}
+		stepIndex++;
+	}
+	// skip the End step
+	stepIndex++;
+	return match;
+}
+
+void PatternMatcher::buildCacheKey() {
+	// the search only depends on the type, the symbol and the length of each element, and the symbol is the interned text
+	cacheKey.clear();
+	cacheKey.push_back((char)reference->patternType);
+	for (const PatternElement &element : reference->patternElements) {
+		cacheKey.push_back((char)element.type);
+		cacheKey.append((const char *)&element.symbol, sizeof(element.symbol));
+	}
+}
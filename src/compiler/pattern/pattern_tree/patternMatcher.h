@@ -0,0 +1,93 @@
+#pragma once
+#include "cachedMatchStep.h"
+#include "matchEvent.h"
+#include "matchProgress.h"
+#include "patternMatch.h"
+#include "patternTreeSlot.h"
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ParseContext;
+struct PatternReference;
+// Finds the best match for a pattern reference with a depth first search through the pattern trees.
+// Progresses and events are stored in scratch buffers which are kept between matches, so a search step doesn't allocate.
+// The sub-expressions starting at an element are searched once per reference and memoised (packrat parsing), so nested
+// '$ + $' chains don't re-match the same sub-expressions in every branch.
+// pushProgress drops a progress whose node can't end a match or take the next element, so a parent doesn't continue
+// with every sub-match, only with those followed by an element it can take.
+// The result of a search only depends on the pattern of the reference and the pattern trees, so it's cached by pattern
+// until a definition is added to the trees. References with the same pattern, like 'set $ to i + $', are searched once.
+class PatternMatcher {
+  public:
+	// returns the match, or nothing if the reference doesn't match. it only reads the context and the reference, so
+	// matchers on different threads can search at the same time while the pattern trees don't change.
+	// if emptySlots is given, the empty slots of the pattern trees which the search looked at are added to it. a failed
+	// match can only succeed after a definition fills one of them.
+	std::optional<PatternMatch>
+	find(const ParseContext &context, PatternReference *reference, std::vector<PatternTreeSlot> *emptySlots = nullptr);
+
+  private:
+	// the sub-matches found from a start element
+	struct SubMatchMemo {
+		// the newest SubMatch event of the finished sub-matches. they link back in reverse order of discovery
+		uint32_t lastSubMatch = noMatchIndex;
+		bool searched{};
+	};
+
+	// explore the search stack above stackBase. returns the progress which matched the whole reference, or noMatchIndex
+	uint32_t search(size_t stackBase);
+	// push the alternative steps we could take through the pattern tree to the search stack, ordered from least
+	// important to most important
+	void step(uint32_t progressIndex);
+	// continue the parent progress with each sub-match starting at its element, searching them if not memoised yet
+	void substitute(uint32_t parentIndex);
+	// continue the parent progress with the finished progress as sub-match
+	void stepUp(const MatchProgress &parentProgress, uint32_t finishedIndex);
+	uint32_t addProgress(const MatchProgress &progress);
+	void pushProgress(const MatchProgress &progress);
+	uint32_t addEvent(const MatchEvent &event);
+	uint32_t addNodePassed(uint32_t previous, PatternTreeNode *node);
+	void addEmptySlot(const PatternTreeSlot &slot);
+	// whether a progress at the node can finish a match or take the element at elementIndex. if it can't, the empty
+	// slots its step would have looked at are added instead
+	bool canContinue(const PatternTreeNode *node, uint32_t elementIndex);
+	// add the cached steps of a finished progress, from its events
+	void cacheMatch(uint32_t progressIndex);
+	// build the match for the current reference from the cached steps at stepIndex, and move stepIndex past them
+	PatternMatch applyMatch(size_t &stepIndex) const;
+	// the cache key of the current reference: its section type and the type and symbol of each element
+	void buildCacheKey();
+
+	// flags on search stack entries, the other bits are the progress index
+	// the progress is a parent waiting for its sub-matches
+	static constexpr uint32_t substituteFlag = 1u << 31;
+	// the progress is a finished sub-match which should be added to the memo of the current search
+	static constexpr uint32_t finishedFlag = 1u << 30;
+	static constexpr uint32_t progressIndexMask = finishedFlag - 1;
+
+	const ParseContext *context{};
+	PatternReference *reference{};
+	std::vector<PatternTreeSlot> *emptySlots{};
+	std::vector<MatchProgress> progresses;
+	std::vector<MatchEvent> events;
+	// indices of the progresses still to explore. the last one is explored first
+	std::vector<uint32_t> searchStack;
+	// per start element
+	std::vector<SubMatchMemo> subMatchMemos;
+	// the start element of the sub-match search in progress, or the element count for the search of the reference itself
+	uint32_t currentSearch{};
+	// [search][end element]: whether a match of the search already finished at that element. a parent continues the same
+	// way from any match ending there, so only the first one is continued
+	std::vector<bool> finishedEnds;
+	// the first cached step of the match by cache key, or noMatchIndex if the pattern doesn't match. failures are only
+	// cached when no empty slots are asked for
+	std::unordered_map<std::string, uint32_t> cache;
+	std::vector<CachedMatchStep> cachedSteps;
+	// the pattern trees the cache is for
+	uint32_t cacheGeneration{};
+	std::string cacheKey;
+	// the events of the progresses being cached, oldest last
+	std::vector<uint32_t> eventChain;
+};
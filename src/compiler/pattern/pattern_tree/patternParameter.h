@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+
+struct PatternDefinition;
+// the name (symbol) a pattern definition gives to the argument or word at a pattern tree node
+struct PatternParameter {
+	PatternDefinition *definition;
+	uint32_t name;
+};
@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+
+struct PatternTreeNode;
+// a literal child of a pattern tree node, found by the symbol of its pattern text
+struct PatternTreeEdge {
+	uint32_t symbol;
+	PatternTreeNode *child;
+};
@@ -1,10 +1,49 @@
 #include "patternTreeNode.h"
+#include "arena.h"
+#include <algorithm>
+#include <bit>
+#include <unordered_map>
 #include <unordered_set>
 
+// Make room for one more item in an array in the arena. the capacity of an array is its size rounded up to a power of
+// two, so a full array is copied to one twice as big.
+template <typename T> static void growByOne(Arena &arena, std::span<T> &array) {
+	if (array.empty() || array.size() == std::bit_ceil(array.size())) {
+		std::span<T> grown = arena.createArray<T>(std::bit_ceil(array.size() + 1));
+		std::copy(array.begin(), array.end(), grown.begin());
+		array = grown.first(array.size());
+	}
+	array = {array.data(), array.size() + 1};
+}
+
+static void setParameterName(Arena &arena, PatternTreeNode *node, PatternDefinition *definition, uint32_t name) {
+	auto it = std::find_if(node->parameterNames.begin(), node->parameterNames.end(), [definition](auto &parameter) {
+		return parameter.definition == definition;
+	});
+	if (it == node->parameterNames.end()) {
+		growByOne(arena, node->parameterNames);
+		it = node->parameterNames.end() - 1;
+	}
+	*it = {definition, name};
+}
+
+static void addLiteralChild(Arena &arena, PatternTreeNode *node, uint32_t symbol, PatternTreeNode *child) {
+	growByOne(arena, node->literalChildren);
+	// shift the bigger symbols up to keep the children sorted
+	auto it = std::upper_bound(
+		node->literalChildren.begin(), node->literalChildren.end() - 1, symbol,
+		[](uint32_t symbol, const PatternTreeEdge &edge) { return symbol < edge.symbol; }
+	);
+	std::copy_backward(it, node->literalChildren.end() - 1, node->literalChildren.end());
+	*it = {symbol, child};
+}
+
 // Link all parent nodes to a shared child for the given element.
 // Reuses existing children where possible; creates one shared new child for parents that lack one.
-static std::vector<PatternTreeNode *>
-addSharedChild(const std::vector<PatternTreeNode *> &parents, const PatternElement &elem, PatternDefinition *definition) {
+static std::vector<PatternTreeNode *> addSharedChild(
+	Arena &arena, const std::vector<PatternTreeNode *> &parents, const PatternElement &elem, PatternDefinition *definition,
+	std::vector<PatternTreeSlot> *filledSlots
+) {
 	PatternTreeNode *sharedNew = nullptr;
 	std::vector<PatternTreeNode *> children;
 	std::unordered_set<PatternTreeNode *> seen;
@@ -17,30 +56,33 @@ addSharedChild(const std::vector<PatternTreeNode *> &parents, const PatternEleme
 		} else if (elem.type == PatternElement::Type::Word) {
 			child = parent->wordChild;
 		} else {
-			auto it = parent->literalChildren.find(elem.text);
-			if (it != parent->literalChildren.end())
-				child = it->second;
+			child = parent->literalChild(elem.symbol);
 		}
 
 		if (child) {
 			// parent already has a child for this element — reuse it
 			if (elem.type == PatternElement::Type::Variable || elem.type == PatternElement::Type::Word)
-				child->parameterNames[definition] = elem.text;
+				setParameterName(arena, child, definition, elem.symbol);
 			if (seen.insert(child).second)
 				children.push_back(child);
 		} else {
 			// parent doesn't have a child — share one new node across all such parents
 			if (!sharedNew)
-				sharedNew = new PatternTreeNode(elem.type, elem.text);
+				sharedNew = arena.create<PatternTreeNode>();
+			PatternTreeSlot slot{parent, PatternTreeSlot::Kind::Literal, elem.symbol};
 			if (elem.type == PatternElement::Type::Variable) {
 				parent->argumentChild = sharedNew;
-				sharedNew->parameterNames[definition] = elem.text;
+				setParameterName(arena, sharedNew, definition, elem.symbol);
+				slot = {parent, PatternTreeSlot::Kind::Argument};
 			} else if (elem.type == PatternElement::Type::Word) {
 				parent->wordChild = sharedNew;
-				sharedNew->parameterNames[definition] = elem.text;
+				setParameterName(arena, sharedNew, definition, elem.symbol);
+				slot = {parent, PatternTreeSlot::Kind::Word};
 			} else {
-				parent->literalChildren[elem.text] = sharedNew;
+				addLiteralChild(arena, parent, elem.symbol, sharedNew);
 			}
+			if (filledSlots)
+				filledSlots->push_back(slot);
 			if (seen.insert(sharedNew).second)
 				children.push_back(sharedNew);
 		}
@@ -52,13 +94,14 @@ addSharedChild(const std::vector<PatternTreeNode *> &parents, const PatternEleme
 // Walk a sequence of elements through the tree, branching at Choice elements
 // and converging all branches back to shared nodes afterward.
 static std::vector<PatternTreeNode *> addElementSequence(
-	std::vector<PatternTreeNode *> currentNodes, const std::vector<PatternElement> &elements, PatternDefinition *definition
+	Arena &arena, std::vector<PatternTreeNode *> currentNodes, const std::vector<PatternElement> &elements,
+	PatternDefinition *definition, std::vector<PatternTreeSlot> *filledSlots
 ) {
 	for (auto &elem : elements) {
 		if (elem.type == PatternElement::Type::Choice) {
 			std::vector<PatternTreeNode *> branchEndpoints;
 			for (auto &alternative : elem.alternatives) {
-				auto endpoints = addElementSequence(currentNodes, alternative, definition);
+				auto endpoints = addElementSequence(arena, currentNodes, alternative, definition, filledSlots);
 				branchEndpoints.insert(branchEndpoints.end(), endpoints.begin(), endpoints.end());
 			}
 			// deduplicate — branches that converged to the same node
@@ -69,16 +112,90 @@ static std::vector<PatternTreeNode *> addElementSequence(
 					currentNodes.push_back(node);
 			}
 		} else {
-			currentNodes = addSharedChild(currentNodes, elem, definition);
+			currentNodes = addSharedChild(arena, currentNodes, elem, definition, filledSlots);
 		}
 	}
 	return currentNodes;
 }
 
-void PatternTreeNode::addPatternPart(std::vector<PatternElement> &elements, PatternDefinition *definition, size_t index) {
+void PatternTreeNode::addPatternPart(
+	Arena &arena, std::vector<PatternElement> &elements, PatternDefinition *definition, size_t index,
+	std::vector<PatternTreeSlot> *filledSlots
+) {
 	std::vector<PatternElement> remaining(elements.begin() + index, elements.end());
-	auto endpoints = addElementSequence({this}, remaining, definition);
+	auto endpoints = addElementSequence(arena, {this}, remaining, definition, filledSlots);
 	for (auto *node : endpoints) {
+		if (filledSlots && !node->matchingDefinition)
+			filledSlots->push_back({node, PatternTreeSlot::Kind::Definition});
 		node->matchingDefinition = definition;
 	}
 }
+
+PatternTreeNode *PatternTreeNode::literalChild(uint32_t symbol) const {
+	auto it = std::lower_bound(
+		literalChildren.begin(), literalChildren.end(), symbol,
+		[](const PatternTreeEdge &edge, uint32_t symbol) { return edge.symbol < symbol; }
+	);
+	return it != literalChildren.end() && it->symbol == symbol ? it->child : nullptr;
+}
+
+bool PatternTreeNode::canStartWith(const PatternElement &element) const {
+	// an argument child takes any element, or a sub-expression which starts with it
+	return argumentChild || (wordChild && element.type == PatternElement::Type::VariableLike) ||
+		   (element.type != PatternElement::Type::Variable && literalChild(element.symbol));
+}
+
+uint32_t PatternTreeNode::parameterName(PatternDefinition *definition) const {
+	for (const PatternParameter &parameter : parameterNames) {
+		if (parameter.definition == definition)
+			return parameter.name;
+	}
+	return noSymbol;
+}
+
+PatternTreeNode *PatternTreeNode::freeze(Arena &arena) const {
+	// number the nodes. nodes can have multiple parents, since branches converge after choices
+	std::vector<const PatternTreeNode *> nodes;
+	std::unordered_map<const PatternTreeNode *, size_t> nodeIndices;
+	size_t edgeCount = 0;
+	size_t parameterCount = 0;
+	std::vector<const PatternTreeNode *> nodesToVisit{this};
+	while (nodesToVisit.size()) {
+		const PatternTreeNode *node = nodesToVisit.back();
+		nodesToVisit.pop_back();
+		if (!nodeIndices.emplace(node, nodes.size()).second)
+			continue;
+		nodes.push_back(node);
+		edgeCount += node->literalChildren.size();
+		parameterCount += node->parameterNames.size();
+		// visit in the order the matcher tries them: literals first, then words, then arguments
+		if (node->argumentChild)
+			nodesToVisit.push_back(node->argumentChild);
+		if (node->wordChild)
+			nodesToVisit.push_back(node->wordChild);
+		for (auto it = node->literalChildren.rbegin(); it != node->literalChildren.rend(); ++it)
+			nodesToVisit.push_back(it->child);
+	}
+
+	std::span<PatternTreeNode> frozenNodes = arena.createArray<PatternTreeNode>(nodes.size());
+	std::span<PatternTreeEdge> edges = arena.createArray<PatternTreeEdge>(edgeCount);
+	std::span<PatternParameter> parameters = arena.createArray<PatternParameter>(parameterCount);
+	auto frozen = [&](const PatternTreeNode *node) { return node ? &frozenNodes[nodeIndices[node]] : nullptr; };
+	for (size_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++) {
+		const PatternTreeNode *node = nodes[nodeIndex];
+		PatternTreeNode &copy = frozenNodes[nodeIndex];
+		copy.matchingDefinition = node->matchingDefinition;
+		copy.argumentChild = frozen(node->argumentChild);
+		copy.wordChild = frozen(node->wordChild);
+		copy.literalChildren = edges.first(node->literalChildren.size());
+		edges = edges.subspan(node->literalChildren.size());
+		std::transform(
+			node->literalChildren.begin(), node->literalChildren.end(), copy.literalChildren.begin(),
+			[&](const PatternTreeEdge &edge) { return PatternTreeEdge{edge.symbol, frozen(edge.child)}; }
+		);
+		copy.parameterNames = parameters.first(node->parameterNames.size());
+		parameters = parameters.subspan(node->parameterNames.size());
+		std::copy(node->parameterNames.begin(), node->parameterNames.end(), copy.parameterNames.begin());
+	}
+	return &frozenNodes[0];
+}
@@ -1,21 +1,40 @@
 #pragma once
 #include "patternElement.h"
-#include <unordered_map>
+#include "patternParameter.h"
+#include "patternTreeEdge.h"
+#include "patternTreeSlot.h"
+#include <span>
 
+class Arena;
 struct PatternDefinition;
-struct PatternTreeNode : public PatternElement {
+// A node of a pattern tree. The tree grows while pattern definitions resolve and is frozen into one contiguous array
+// afterwards. Children and parameters are arrays in the arena, compared by symbol, so walking the tree doesn't hash text.
+struct PatternTreeNode {
 	// the pattern definition that ends at this node (if any)
 	PatternDefinition *matchingDefinition{};
-	// these child nodes branch off based on their pattern strings
-	std::unordered_map<std::string, PatternTreeNode *> literalChildren{};
+	// these child nodes branch off based on their pattern strings, sorted by symbol
+	std::span<PatternTreeEdge> literalChildren{};
 	// this child node accepts a variable or the result of an expression
 	PatternTreeNode *argumentChild{};
 	// this child node captures a single word as a string literal ({word:name} syntax)
 	PatternTreeNode *wordChild{};
-	// for argument/word nodes: maps pattern definition to parameter name
+	// for argument/word nodes: the parameter name per pattern definition
 	// (multiple definitions can share the same argument node with different parameter names)
-	std::unordered_map<PatternDefinition *, std::string> parameterNames{};
-	using PatternElement::PatternElement;
-	void addPatternPart(std::vector<PatternElement> &elements, PatternDefinition *definition, size_t index = 0);
-	PatternTreeNode *match(const std::vector<PatternElement> &elements);
+	std::span<PatternParameter> parameterNames{};
+
+	// returns nullptr if there's no literal child for the symbol
+	PatternTreeNode *literalChild(uint32_t symbol) const;
+	// whether a step from this node can take the element: a literal child with its symbol, a word child for a word, or
+	// an argument child
+	bool canStartWith(const PatternElement &element) const;
+	// returns noSymbol if the definition has no parameter at this node
+	uint32_t parameterName(PatternDefinition *definition) const;
+	// new nodes are allocated in arena. the slots which were empty before are added to filledSlots, if given
+	void addPatternPart(
+		Arena &arena, std::vector<PatternElement> &elements, PatternDefinition *definition, size_t index = 0,
+		std::vector<PatternTreeSlot> *filledSlots = nullptr
+	);
+	// copy the tree below this node to one array in arena, in depth first order, and return the copy of this node.
+	// the copy can't be extended anymore.
+	PatternTreeNode *freeze(Arena &arena) const;
 };
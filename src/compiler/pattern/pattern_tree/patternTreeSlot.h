@@ -0,0 +1,29 @@
+#pragma once
+#include "symbolTable.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+struct PatternTreeNode;
+// a place in a pattern tree which a pattern definition can fill: a literal child, the argument child, the word child or
+// the matching definition of a node. once filled, a slot stays filled.
+struct PatternTreeSlot {
+	enum class Kind : uint8_t {
+		Literal,
+		Argument,
+		Word,
+		Definition,
+	};
+	const PatternTreeNode *node;
+	Kind kind;
+	// Literal: the symbol of the child
+	uint32_t symbol = noSymbol;
+
+	bool operator==(const PatternTreeSlot &other) const = default;
+
+	struct Hash {
+		size_t operator()(const PatternTreeSlot &slot) const {
+			return std::hash<const void *>()(slot.node) ^ ((size_t)slot.symbol << 2 | (size_t)slot.kind);
+		}
+	};
+};
@@ -0,0 +1,16 @@
+#include "symbolTable.h"
+
+uint32_t SymbolTable::intern(std::string_view text) {
+	auto it = ids.find(text);
+	if (it != ids.end())
+		return it->second;
+	uint32_t symbol = texts.size();
+	texts.emplace_back(text);
+	ids.emplace(texts.back(), symbol);
+	return symbol;
+}
+
+uint32_t SymbolTable::find(std::string_view text) const {
+	auto it = ids.find(text);
+	return it == ids.end() ? noSymbol : it->second;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// symbol value for text which was never interned
+constexpr uint32_t noSymbol = UINT32_MAX;
+
+// Interns pattern text into dense integer ids, so the pattern trees can compare words without hashing strings.
+class SymbolTable {
+  public:
+	// returns the symbol of the text, adding it if it's new
+	uint32_t intern(std::string_view text);
+	// returns the symbol of the text, or noSymbol if it was never interned
+	uint32_t find(std::string_view text) const;
+	const std::string &text(uint32_t symbol) const { return texts[symbol]; }
+
+  private:
+	// a deque doesn't move its strings when growing, so the keys of ids can point into it
+	std::deque<std::string> texts;
+	std::unordered_map<std::string_view, uint32_t> ids;
+};
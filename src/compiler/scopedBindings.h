@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Names bound during codegen, in frames which are pushed when entering a macro expansion or a function body and popped
+// when leaving it. A name is looked up from the innermost frame outwards, so inner bindings shadow outer ones. Pushing and
+// popping a frame costs the number of bindings in it. Names are symbols of the symbol table.
+template <typename Value> class ScopedBindings {
+  public:
+	// hideOuter: the outer frames can't be seen until this frame is popped
+	void pushFrame(bool hideOuter = false) {
+		frames.push_back({bindings.size(), hideOuter ? bindings.size() : visibleStart()});
+	}
+	void popFrame() {
+		bindings.erase(bindings.begin() + frames.back().start, bindings.end());
+		frames.pop_back();
+	}
+	// binds the name in the innermost frame
+	void bind(uint32_t name, Value value) { bindings.push_back({name, value}); }
+	// returns nullptr if the name isn't bound in a visible frame
+	const Value *find(uint32_t name) const { return find(name, visibleStart(), bindings.size()); }
+	// like find, but in the frames which were visible before the innermost frame was pushed. a frame hiding them can
+	// bind its names to values found there
+	const Value *findOuter(uint32_t name) const {
+		size_t outerStart = frames.size() > 1 ? frames[frames.size() - 2].visibleStart : 0;
+		return find(name, outerStart, frames.empty() ? bindings.size() : frames.back().start);
+	}
+
+  private:
+	struct Binding {
+		uint32_t name;
+		Value value;
+	};
+	struct Frame {
+		// the index of the first binding of the frame
+		size_t start;
+		// the index of the first binding lookups see
+		size_t visibleStart;
+	};
+
+	size_t visibleStart() const { return frames.empty() ? 0 : frames.back().visibleStart; }
+	const Value *find(uint32_t name, size_t start, size_t end) const {
+		for (size_t index = end; index > start; index--) {
+			if (bindings[index - 1].name == name)
+				return &bindings[index - 1].value;
+		}
+		return nullptr;
+	}
+
+	std::vector<Binding> bindings;
+	std::vector<Frame> frames;
+};
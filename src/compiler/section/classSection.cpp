@@ -54,10 +54,10 @@ bool ClassSection::processLine(ParseContext &context, CodeLine *line) {
 
 Section *ClassSection::createSection(ParseContext &context, CodeLine *line) {
 	if (line->patternText == "patterns") {
-		return new PatternsSection(this);
+		return context.arena.create<PatternsSection>(this);
 	}
 	if (line->patternText == "members") {
-		return new MembersSection(this);
+		return context.arena.create<MembersSection>(this);
 	}
 
 	// Fall back to base class (handles "replacement" for macros, or gives error)
@@ -3,7 +3,8 @@
 #include "definitionSection.h"
 
 struct ClassSection : public DefinitionSection {
-	ClassSection(Section *parent) : DefinitionSection(SectionType::Class, parent) { classDefinition = new ClassDefinition(); }
+	ClassSection(Section *parent, ClassDefinition *classDefinition)
+		: DefinitionSection(SectionType::Class, parent), classDefinition(classDefinition) {}
 
 	ClassDefinition *classDefinition;
 
@@ -13,11 +13,11 @@ bool DefinitionSection::processLine(ParseContext &context, CodeLine *line) {
 Section *DefinitionSection::createSection(ParseContext &context, CodeLine *line) {
 	// Macros use "replacement", handled here in base class
 	if (isMacro && line->patternText == "replacement") {
-		return new Section(SectionType::Replacement, this);
+		return context.arena.create<Section>(SectionType::Replacement, this);
 	}
 
 	if (line->patternText == "patterns") {
-		return new PatternsSection(this);
+		return context.arena.create<PatternsSection>(this);
 	}
 
 	// Nothing matched - give error
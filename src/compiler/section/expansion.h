@@ -0,0 +1,66 @@
+#pragma once
+#include "expression.h"
+#include "type.h"
+#include <unordered_map>
+#include <vector>
+
+struct Instantiation;
+// The types inferred for the body of a macro, effect or function for one combination of arguments. Calls with the same
+// key share an expansion, so the body is only inferred again when a type it read changed.
+struct Expansion {
+	// how a body uses a parameter. without a use, the body only depends on the type of the argument
+	enum Use : uint8_t {
+		// the body stores to the parameter, which stores to the variable passed
+		StoredThrough = 1,
+		// the body uses the parameter as a field or type name
+		UsedAsName = 2,
+	};
+	// what inferring the body depends on for one argument
+	struct Argument {
+		Type type;
+		// the Variable a variable argument refers to, or the argument expression itself if it's not a literal.
+		// only set if the parameter is stored through or used as a name
+		const void *identity{};
+		// the value of a literal argument used as a name
+		decltype(Expression::literalValue) literalValue;
+
+		bool operator<(const Argument &other) const {
+			if (type != other.type)
+				return type < other.type;
+			if (identity != other.identity)
+				return identity < other.identity;
+			return literalValue < other.literalValue;
+		}
+	};
+	struct Key {
+		std::vector<Argument> arguments;
+		// the instantiation a return in the body sets the type of
+		Instantiation *instantiation{};
+
+		bool operator<(const Key &other) const {
+			if (instantiation != other.instantiation)
+				return instantiation < other.instantiation;
+			return arguments < other.arguments;
+		}
+	};
+
+	// the types of the body expressions and of the argument expressions in this expansion
+	std::unordered_map<const Expression *, Type> types;
+	// the expansions the calls in the body use
+	std::unordered_map<const Expression *, Expansion *> callees;
+	// macros: the type of the last deduced replacement line
+	Type resultType;
+	// whether the body has to be inferred (again), because it never was or a type it read changed
+	bool stale = true;
+
+	// expressions which are not part of this expansion keep their own type
+	Type typeOf(const Expression *expression) const {
+		auto it = types.find(expression);
+		return it != types.end() ? it->second : expression->type;
+	}
+	// returns nullptr if the call isn't part of this expansion
+	Expansion *calleeOf(const Expression *call) const {
+		auto it = callees.find(call);
+		return it != callees.end() ? it->second : nullptr;
+	}
+};
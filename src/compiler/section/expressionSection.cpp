@@ -4,7 +4,7 @@
 Section *ExpressionSection::createSection(ParseContext &context, CodeLine *line) {
 	// ExpressionSection uses "get" for its content
 	if (line->patternText == "get") {
-		return new Section(SectionType::Get, this);
+		return context.arena.create<Section>(SectionType::Get, this);
 	}
 
 	// Fall back to base class (handles "replacement" for macros, or gives error)
@@ -20,13 +20,9 @@ static Type parseFieldType(ParseContext &context, std::string_view typeStr) {
 		while (!remaining.empty() && node) {
 			size_t space = remaining.find(' ');
 			std::string_view word = (space != std::string_view::npos) ? remaining.substr(0, space) : remaining;
-			auto it = node->literalChildren.find(std::string(word));
-			if (it != node->literalChildren.end()) {
-				node = it->second;
-				remaining = (space != std::string_view::npos) ? remaining.substr(space + 1) : std::string_view{};
-			} else {
-				node = nullptr;
-			}
+			// words which were never interned can't be in the tree
+			node = node->literalChild(context.symbols.find(word));
+			remaining = (space != std::string_view::npos) ? remaining.substr(space + 1) : std::string_view{};
 		}
 		if (node && node->matchingDefinition && node->matchingDefinition->section &&
 			node->matchingDefinition->section->type == SectionType::Class) {
@@ -0,0 +1,35 @@
+#pragma once
+#include "diagnostic.h"
+#include "sectionType.h"
+#include "smallVector.h"
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Arena;
+struct CodeLine;
+struct Expression;
+struct PatternReference;
+struct Section;
+// The expression of a line to detect. Detecting it only depends on the line, so lines are detected on worker threads.
+// What the detection would add to the context is kept here, and applied in line order once all lines are detected.
+struct PatternDetection {
+	CodeLine *line;
+	// the section the pattern references are added to
+	Section *section;
+	SectionType patternType;
+	// the number of context diagnostics before this line, so its diagnostics are inserted in line order
+	size_t diagnosticIndex;
+	// the arena of the worker, which the expressions are created in
+	Arena *arena{};
+	Expression *expression{};
+	// most lines only have a few references, so they don't allocate
+	SmallVector<PatternReference *, 4> patternReferences{};
+	std::vector<Diagnostic> diagnostics{};
+	// the string literals point at their text here until it's interned in the context
+	std::list<std::pair<Expression *, std::string>> stringLiterals{};
+};
+
+// build the expression tree of the line, with a pending pattern reference for each pattern in it
+void detectPatterns(PatternDetection &detection);
@@ -1,9 +1,9 @@
 #include "patternsSection.h"
 #include "parseContext.h"
 
-bool PatternsSection::processLine(ParseContext &, CodeLine *line) {
+bool PatternsSection::processLine(ParseContext &context, CodeLine *line) {
 	// directly add this line as pattern definition
-	parent->patternDefinitions.push_back(new PatternDefinition(Range(line, line->patternText), parent));
+	parent->patternDefinitions.push_back(context.arena.create<PatternDefinition>(Range(line, line->patternText), parent));
 	line->resolved = true;
 	return true;
 }
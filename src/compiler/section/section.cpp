@@ -3,10 +3,13 @@
 #include "effectSection.h"
 #include "expression.h"
 #include "expressionSection.h"
+#include "lexer.h"
 #include "parseContext.h"
+#include "patternDetection.h"
 #include "patternTreeNode.h"
 #include "sectionSection.h"
 #include "stringHierarchy.h"
+#include <memory>
 #include <stack>
 using namespace std::literals;
 
@@ -42,8 +45,9 @@ void Section::collectPatternReferencesAndSections(
 }
 
 bool Section::processLine(ParseContext &context, CodeLine *line) {
-	line->expression = detectPatterns(context, Range(line, line->patternText), SectionType::Effect);
-	return line->expression != nullptr;
+	// the expression is detected once all sections are known, see analyzeSections
+	context.patternDetections.push_back({line, this, SectionType::Effect, context.diagnostics.size()});
+	return true;
 }
 
 Section *Section::createSection(ParseContext &context, CodeLine *line) {
@@ -64,16 +68,16 @@ Section *Section::createSection(ParseContext &context, CodeLine *line) {
 		} else if (current == "local") {
 			isLocal = true;
 		} else if (current == "effect") {
-			newSection = new EffectSection(this);
+			newSection = context.arena.create<EffectSection>(this);
 			break;
 		} else if (current == "expression") {
-			newSection = new ExpressionSection(this);
+			newSection = context.arena.create<ExpressionSection>(this);
 			break;
 		} else if (current == "section") {
-			newSection = new SectionSection(this);
+			newSection = context.arena.create<SectionSection>(this);
 			break;
 		} else if (current == "class") {
-			newSection = new ClassSection(this);
+			newSection = context.arena.create<ClassSection>(this, context.arena.create<ClassDefinition>());
 			break;
 		} else {
 			// Unknown keyword - not a section definition
@@ -86,19 +90,21 @@ Section *Section::createSection(ParseContext &context, CodeLine *line) {
 		newSection->isLocal = isLocal;
 		// Remaining contains the pattern after the section type keyword
 		if (!remaining.empty()) {
-			newSection->patternDefinitions.push_back(new PatternDefinition(Range(line, remaining), newSection));
+			newSection->patternDefinitions.push_back(
+				context.arena.create<PatternDefinition>(Range(line, remaining), newSection)
+			);
 		}
 	}
 	if (!newSection) {
 		// custom section
-		newSection = new Section(SectionType::Custom, this);
-		// detectPatterns already adds the pattern reference via detectPatternsRecursively
-		line->expression = detectPatterns(context, Range(line, line->patternText), SectionType::Section);
+		newSection = context.arena.create<Section>(SectionType::Custom, this);
+		// the pattern reference of the line is added to this section once it's detected
+		context.patternDetections.push_back({line, this, SectionType::Section, context.diagnostics.size()});
 	}
 	return newSection;
 }
 
-StringHierarchy *createHierarchy(ParseContext &context, Range range) {
+static StringHierarchy *createHierarchy(PatternDetection &detection, Range range) {
 	std::stack<StringHierarchy *> nodeStack;
 	StringHierarchy *base = new StringHierarchy(0, 0);
 	nodeStack.push(base);
@@ -111,14 +117,14 @@ StringHierarchy *createHierarchy(ParseContext &context, Range range) {
 			nodeStack.top()->children.push_back(newChild);
 			nodeStack.push(newChild);
 		};
-		auto tryPop = [&nodeStack, &context, &range, base, index, charachter](char requiredCharachter) {
+		auto tryPop = [&nodeStack, &detection, &range, base, index, charachter](char requiredCharachter) {
 			if (nodeStack.top()->charachter == requiredCharachter) {
 				nodeStack.top()->end = index;
 				nodeStack.pop();
 				return true;
 			} else {
 				delete base;
-				context.diagnostics.push_back(Diagnostic(
+				detection.diagnostics.push_back(Diagnostic(
 					Diagnostic::Level::Error, std::string("unmatched closing charachter found: '") + charachter + "'",
 					Range(range.line, range.subString.substr(index, 1))
 				));
@@ -146,7 +152,7 @@ StringHierarchy *createHierarchy(ParseContext &context, Range range) {
 			while (true) {
 				stringIt = std::find(stringIt + 1, range.subString.end(), '\"');
 				if (stringIt == range.subString.end()) {
-					context.diagnostics.push_back(Diagnostic(
+					detection.diagnostics.push_back(Diagnostic(
 						Diagnostic::Level::Error, std::string("unmatched string charachter found: '\"'"),
 						Range(range.line, range.subString.substr(index, 1))
 					));
@@ -183,7 +189,7 @@ StringHierarchy *createHierarchy(ParseContext &context, Range range) {
 				nodeStack.pop();
 				push();
 			} else {
-				context.diagnostics.push_back(Diagnostic(
+				detection.diagnostics.push_back(Diagnostic(
 					Diagnostic::Level::Error, std::string("found comma without enclosing braces"),
 					Range(range.line, range.subString.substr(index, 1))
 				));
@@ -198,7 +204,7 @@ StringHierarchy *createHierarchy(ParseContext &context, Range range) {
 	}
 	if (nodeStack.size() > 1) {
 		while (nodeStack.size() > 1) {
-			context.diagnostics.push_back(Diagnostic(
+			detection.diagnostics.push_back(Diagnostic(
 				Diagnostic::Level::Error, "unmatched closing charachter found: '"s + nodeStack.top()->charachter + "'",
 				range.subRange(nodeStack.top()->start, nodeStack.top()->start + 1)
 			));
@@ -212,45 +218,38 @@ StringHierarchy *createHierarchy(ParseContext &context, Range range) {
 	return base;
 }
 
-Expression *Section::detectPatterns(ParseContext &context, Range range, SectionType patternType) {
-	StringHierarchy *hierarchy = createHierarchy(context, range);
-	if (!hierarchy)
-		return nullptr;
-	Expression *expr = detectPatternsRecursively(context, range, hierarchy, patternType);
-	delete hierarchy;
-	return expr;
-}
-
-static Expression *createStringLiteral(Range range, StringHierarchy *strNode) {
-	Expression *strExpr = new Expression();
+static Expression *createStringLiteral(PatternDetection &detection, Range range, StringHierarchy *strNode) {
+	Expression *strExpr = detection.arena->create<Expression>();
 	strExpr->range = range.subRange(strNode->start - 1, strNode->end + 1);
+	std::string text = processEscapeSequences(range.subString.substr(strNode->start, strNode->end - strNode->start));
 	strExpr->kind = Expression::Kind::Literal;
-	strExpr->literalValue = processEscapeSequences(range.subString.substr(strNode->start, strNode->end - strNode->start));
+	// the text is interned when the detection is applied
+	strExpr->literalValue = std::string_view(detection.stringLiterals.emplace_back(strExpr, std::move(text)).second);
 	return strExpr;
 }
 
-Expression *
-Section::detectPatternsRecursively(ParseContext &context, Range range, StringHierarchy *node, SectionType patternType) {
+static Expression *
+detectPatternsRecursively(PatternDetection &detection, Range range, StringHierarchy *node, SectionType patternType) {
 	Range relativeRange = Range(range.line, range.subString.substr(node->start, node->end - node->start));
 
-	Expression *expr = new Expression();
+	Expression *expr = detection.arena->create<Expression>();
 	expr->range = relativeRange;
 	// This is a pending pattern reference (will be resolved later)
 	expr->kind = Expression::Kind::Pending;
 
 	// Create a PatternReference for pattern matching
-	PatternReference *reference = new PatternReference(expr, patternType);
+	PatternReference *reference = detection.arena->create<PatternReference>(expr, patternType);
 	expr->patternReference = reference;
 
 	// Process children to find arguments
-	auto delegate = [this, &context, &range, &expr](StringHierarchy *childNode) -> bool {
+	auto delegate = [&detection, &range, &expr](StringHierarchy *childNode) -> bool {
+		std::unique_ptr<StringHierarchy> childHierarchy(childNode->cloneWithOffset(-childNode->start));
 		Expression *childExpr = detectPatternsRecursively(
-			context, range.subRange(childNode->start, childNode->end), childNode->cloneWithOffset(-childNode->start),
-			SectionType::Expression
+			detection, range.subRange(childNode->start, childNode->end), childHierarchy.get(), SectionType::Expression
 		);
 		if (!childExpr)
 			return false;
-		expr->arguments.push_back(childExpr);
+		expr->arguments.pushBack(childExpr);
 		return true;
 	};
 
@@ -267,7 +266,7 @@ Section::detectPatternsRecursively(ParseContext &context, Range range, StringHie
 				size_t intrinsicStart = parenPos - intrinsicKeyword.length();
 				size_t intrinsicEnd = child->end + 1; // +1 for closing ')'
 
-				Expression *intrinsicExpr = new Expression();
+				Expression *intrinsicExpr = detection.arena->create<Expression>();
 				intrinsicExpr->range = range.subRange(intrinsicStart, intrinsicEnd);
 				intrinsicExpr->kind = Expression::Kind::IntrinsicCall;
 
@@ -275,23 +274,16 @@ Section::detectPatternsRecursively(ParseContext &context, Range range, StringHie
 				auto processIntrinsicArg = [&](StringHierarchy *argNode) -> bool {
 					Expression *argExpr;
 					if (argNode->charachter == '"') {
-						argExpr = createStringLiteral(range, argNode);
+						argExpr = createStringLiteral(detection, range, argNode);
 					} else {
+						std::unique_ptr<StringHierarchy> argHierarchy(argNode->cloneWithOffset(-argNode->start));
 						argExpr = detectPatternsRecursively(
-							context, range.subRange(argNode->start, argNode->end), argNode->cloneWithOffset(-argNode->start),
-							SectionType::Expression
+							detection, range.subRange(argNode->start, argNode->end), argHierarchy.get(), SectionType::Expression
 						);
 					}
 					if (!argExpr)
 						return false;
-
-					// First string argument becomes the intrinsic name
-					if (intrinsicExpr->intrinsicName.empty() && argExpr->kind == Expression::Kind::Literal) {
-						if (auto *str = std::get_if<std::string>(&argExpr->literalValue)) {
-							intrinsicExpr->intrinsicName = *str;
-						}
-					}
-					intrinsicExpr->arguments.push_back(argExpr);
+					intrinsicExpr->arguments.pushBack(argExpr);
 					return true;
 				};
 
@@ -305,7 +297,35 @@ Section::detectPatternsRecursively(ParseContext &context, Range range, StringHie
 						return nullptr;
 				}
 
-				expr->arguments.push_back(intrinsicExpr);
+				// Resolve the name, so the later passes don't compare strings
+				const std::string_view *name = nullptr;
+				if (intrinsicExpr->arguments.size())
+					name = std::get_if<std::string_view>(&intrinsicExpr->arguments[0]->literalValue);
+				if (!name) {
+					detection.diagnostics.push_back(Diagnostic(
+						Diagnostic::Level::Error, "the first argument of an intrinsic has to be its name", intrinsicExpr->range
+					));
+					return nullptr;
+				}
+				intrinsicExpr->intrinsic = Intrinsic::find(*name);
+				if (intrinsicExpr->intrinsic == Intrinsic::Id::Unknown) {
+					detection.diagnostics.push_back(Diagnostic(
+						Diagnostic::Level::Error, "unknown intrinsic: " + std::string(*name), intrinsicExpr->arguments[0]->range
+					));
+					return nullptr;
+				}
+				size_t argumentCount = Intrinsic::get(intrinsicExpr->intrinsic).argumentCount;
+				if (intrinsicExpr->arguments.size() - 1 < argumentCount) {
+					detection.diagnostics.push_back(Diagnostic(
+						Diagnostic::Level::Error,
+						"intrinsic " + std::string(*name) + " needs at least " + std::to_string(argumentCount) +
+							(argumentCount == 1 ? " argument" : " arguments"),
+						intrinsicExpr->range
+					));
+					return nullptr;
+				}
+
+				expr->arguments.pushBack(intrinsicExpr);
 				reference->pattern.replaceLine(intrinsicStart, intrinsicEnd);
 			} else {
 				// Regular parentheses - process arguments inside
@@ -321,27 +341,24 @@ Section::detectPatternsRecursively(ParseContext &context, Range range, StringHie
 				reference->pattern.replaceLine(child->start - "("sv.length(), child->end + ")"sv.length());
 			}
 		} else if (child->charachter == '"') {
-			expr->arguments.push_back(createStringLiteral(range, child));
+			expr->arguments.pushBack(createStringLiteral(detection, range, child));
 			reference->pattern.replaceLine(child->start - "\""sv.length(), child->end + "\""sv.length());
 		}
 	}
 
 	// Replace number literals in pattern text and create sub-expressions.
-	// Search the transformed pattern text (where strings/intrinsics are already replaced with \a)
+	// Tokenize the transformed pattern text (where strings/intrinsics are already replaced with \a)
 	// to avoid matching digits inside string literals (e.g. "i64").
-	std::regex numLiteralRegex("\\b\\d+(?:\\.\\d+)?\\b");
 	std::string patternSnapshot = reference->pattern.text;
-	std::sregex_iterator iter(patternSnapshot.begin(), patternSnapshot.end(), numLiteralRegex);
-	std::sregex_iterator end;
-	// Collect matches, then process in reverse so pattern positions stay valid
-	std::vector<std::tuple<size_t, size_t, std::string>> numMatches;
-	for (; iter != end; ++iter)
-		numMatches.emplace_back(iter->position(), iter->position() + iter->length(), iter->str());
-	for (auto it = numMatches.rbegin(); it != numMatches.rend(); ++it) {
-		auto &[pos, endPos, numStr] = *it;
-		Expression *numExpr = new Expression();
-		size_t lineStart = reference->pattern.getLinePos(pos);
-		size_t lineEnd = reference->pattern.getLinePos(endPos);
+	std::vector<PatternToken> tokens = tokenizePattern(patternSnapshot);
+	// Process number literals in reverse so pattern positions stay valid
+	for (auto it = tokens.rbegin(); it != tokens.rend(); ++it) {
+		if (it->type != PatternToken::Type::Number)
+			continue;
+		std::string numStr = patternSnapshot.substr(it->start, it->end - it->start);
+		Expression *numExpr = detection.arena->create<Expression>();
+		size_t lineStart = reference->pattern.getLinePos(it->start);
+		size_t lineEnd = reference->pattern.getLinePos(it->end);
 		numExpr->range = relativeRange.subRange(lineStart, lineEnd);
 		numExpr->kind = Expression::Kind::Literal;
 		if (numStr.find('.') != std::string::npos) {
@@ -349,53 +366,70 @@ Section::detectPatternsRecursively(ParseContext &context, Range range, StringHie
 		} else {
 			numExpr->literalValue = static_cast<int64_t>(std::stoll(numStr));
 		}
-		expr->arguments.push_back(numExpr);
-		reference->pattern.replacePattern(pos, endPos);
+		expr->arguments.pushBack(numExpr);
+		reference->pattern.replacePattern(it->start, it->end);
 	}
 
 	// Whitespace handling
-	auto addWhiteSpaceWarning = [&context, &range, &reference](size_t start, size_t end) {
-		context.diagnostics.push_back(Diagnostic(
+	auto addWhiteSpaceWarning = [&detection, &range, &reference](size_t start, size_t end) {
+		detection.diagnostics.push_back(Diagnostic(
 			Diagnostic::Level::Warning, "all whitespace in patterns should be a single space",
 			range.subRange(reference->pattern.getLinePos(start), reference->pattern.getLinePos(end))
 		));
 	};
 
-	std::smatch matches;
+	// Whitespace tokens were found before the number literals shrank to a single argument char, shift them to match
+	std::vector<PatternToken> whiteSpaceTokens;
+	size_t numberShift = 0;
+	for (PatternToken token : tokens) {
+		if (token.type == PatternToken::Type::Number) {
+			numberShift += token.end - token.start - 1;
+		} else {
+			token.start -= numberShift;
+			token.end -= numberShift;
+			whiteSpaceTokens.push_back(token);
+		}
+	}
+	auto isSingleSpace = [&reference](const PatternToken &token) {
+		return token.end - token.start == 1 && reference->pattern.text[token.start] == ' ';
+	};
 
 	// Trim left
-	std::regex_search(reference->pattern.text, matches, std::regex("^(\\s*)"));
-	std::string leftWhiteSpace = matches[0];
-	if (!leftWhiteSpace.empty()) {
-		if (leftWhiteSpace != " ") {
-			addWhiteSpaceWarning(0, leftWhiteSpace.size());
+	size_t trimmedLeft = 0;
+	if (!whiteSpaceTokens.empty() && whiteSpaceTokens.front().start == 0) {
+		PatternToken leftWhiteSpace = whiteSpaceTokens.front();
+		if (!isSingleSpace(leftWhiteSpace)) {
+			addWhiteSpaceWarning(0, leftWhiteSpace.end);
 		}
-		reference->pattern.replacePattern(0, leftWhiteSpace.size(), "");
+		reference->pattern.replacePattern(0, leftWhiteSpace.end, "");
+		trimmedLeft = leftWhiteSpace.end;
+		whiteSpaceTokens.erase(whiteSpaceTokens.begin());
+	}
+	for (PatternToken &token : whiteSpaceTokens) {
+		token.start -= trimmedLeft;
+		token.end -= trimmedLeft;
 	}
 
 	// Trim right
-	std::regex_search(reference->pattern.text, matches, std::regex("(\\s*)$"));
-	std::string rightWhiteSpace = matches[0];
-	if (!rightWhiteSpace.empty()) {
-		if (rightWhiteSpace != " ") {
-			addWhiteSpaceWarning(matches.position(), reference->pattern.text.size());
+	if (!whiteSpaceTokens.empty() && whiteSpaceTokens.back().end == reference->pattern.text.size()) {
+		PatternToken rightWhiteSpace = whiteSpaceTokens.back();
+		if (!isSingleSpace(rightWhiteSpace)) {
+			addWhiteSpaceWarning(rightWhiteSpace.start, rightWhiteSpace.end);
 		}
-		reference->pattern.replacePattern(matches.position(), reference->pattern.text.size(), "");
+		reference->pattern.replacePattern(rightWhiteSpace.start, rightWhiteSpace.end, "");
+		whiteSpaceTokens.pop_back();
 	}
 
 	// Normalize whitespace
-	std::regex spaceRegex = std::regex("\\s{2,}|[^\\S ]");
-	size_t lastIndex = 0;
-	std::cmatch charMatches;
-	while (std::regex_search(
-		reference->pattern.text.c_str() + lastIndex, reference->pattern.text.c_str() + reference->pattern.text.size(),
-		charMatches, spaceRegex
-	)) {
-		size_t matchPos = lastIndex + charMatches.position();
-		size_t endPos = matchPos + charMatches.length();
-		addWhiteSpaceWarning(matchPos, endPos);
-		reference->pattern.replacePattern(matchPos, endPos, " ");
-		lastIndex = matchPos + " "sv.size();
+	size_t normalizedShift = 0;
+	for (PatternToken token : whiteSpaceTokens) {
+		token.start -= normalizedShift;
+		token.end -= normalizedShift;
+		if (!isSingleSpace(token)) {
+			addWhiteSpaceWarning(token.start, token.end);
+			reference->pattern.replacePattern(token.start, token.end, " ");
+			normalizedShift += token.end - token.start - " "sv.size();
+		}
 	}
 
 	// If pattern is just an argument placeholder, return the argument directly
@@ -403,18 +437,26 @@ Section::detectPatternsRecursively(ParseContext &context, Range range, StringHie
 	if (reference->pattern.text == ""s + argumentChar) {
 		Expression *arg = expr->arguments[0];
 		if (patternType == SectionType::Expression || arg->kind == Expression::Kind::IntrinsicCall) {
-			delete expr;
-			delete reference;
+			// expr and reference stay in the arena until the context is destroyed
 			return arg;
 		}
 	}
 
-	addPatternReference(reference);
+	detection.patternReferences.pushBack(reference);
 	return expr;
 }
 
+void detectPatterns(PatternDetection &detection) {
+	Range range(detection.line, detection.line->patternText);
+	StringHierarchy *hierarchy = createHierarchy(detection, range);
+	if (!hierarchy)
+		return;
+	detection.expression = detectPatternsRecursively(detection, range, hierarchy, detection.patternType);
+	delete hierarchy;
+}
+
 void Section::addVariableReference(ParseContext &context, VariableReference *reference) {
-	variableReferences[reference->name].push_back(reference);
+	getVariableTables(context.arena).references[reference->name].push_back(reference);
 	searchParentPatterns(context, reference);
 }
 
@@ -427,15 +469,16 @@ void Section::searchParentPatterns(ParseContext &context, VariableReference *ref
 				return;
 			auto markFound = [&] {
 				if (!found) {
-					VariableReference *varRef = new VariableReference(
+					VariableReference *varRef = context.arena.create<VariableReference>(
 						Range(
 							definition->range.line, definition->range.start() + element.startPos,
 							definition->range.start() + element.startPos + element.text.length()
 						),
 						element.text
 					);
-					variableDefinitions[element.text] = varRef;
-					variableReferences[element.text].push_back(varRef);
+					VariableTables &tables = getVariableTables(context.arena);
+					tables.definitions[element.text] = varRef;
+					tables.references[element.text].push_back(varRef);
 					reference->definition = varRef;
 				}
 				found = true;
@@ -484,10 +527,24 @@ void Section::decrementUnresolved() {
 Variable *Section::findVariable(const std::string &name) {
 	Section *sec = this;
 	while (sec) {
-		auto it = sec->variables.find(name);
-		if (it != sec->variables.end())
-			return it->second;
+		if (sec->variableTables) {
+			auto it = sec->variableTables->variables.find(name);
+			if (it != sec->variableTables->variables.end())
+				return it->second;
+		}
 		sec = sec->parent;
 	}
 	return nullptr;
-}
\ No newline at end of file
+}
+
+Section::VariableTables &Section::getVariableTables(Arena &arena) {
+	if (!variableTables)
+		variableTables = arena.create<VariableTables>();
+	return *variableTables;
+}
+
+Section::DefinitionTables &Section::getDefinitionTables(Arena &arena) {
+	if (!definitionTables)
+		definitionTables = arena.create<DefinitionTables>();
+	return *definitionTables;
+}
@@ -1,9 +1,9 @@
 #pragma once
 #include "codeLine.h"
+#include "expansion.h"
 #include "patternDefinition.h"
 #include "patternReference.h"
 #include "sectionType.h"
-#include "stringHierarchy.h"
 #include "type.h"
 #include "variableReference.h"
 #include <list>
@@ -16,6 +16,7 @@ class Function;
 class BasicBlock;
 } // namespace llvm
 
+class Arena;
 struct ParseContext;
 struct Variable;
 struct Expression;
@@ -36,28 +37,47 @@ struct Section {
 	Section *parent{};
 	std::vector<PatternDefinition *> patternDefinitions;
 	std::vector<PatternReference *> patternReferences;
-	std::unordered_map<std::string, std::vector<VariableReference *>> variableReferences;
-	std::unordered_map<std::string, VariableReference *> variableDefinitions;
 	std::vector<CodeLine *> codeLines;
 	std::vector<Section *> children;
-	std::unordered_map<std::string, Variable *> variables;
-	// Monomorphization: each argument type combination gets its own instantiation
-	std::map<std::vector<Type>, Instantiation> instantiations;
+	// The variables referenced, defined and declared in this section
+	struct VariableTables {
+		std::unordered_map<std::string, std::vector<VariableReference *>> references;
+		std::unordered_map<std::string, VariableReference *> definitions;
+		std::unordered_map<std::string, Variable *> variables;
+	};
+	// The state of a section whose pattern definitions are called
+	struct DefinitionTables {
+		// Count of body references containing each VariableLike text.
+		// Shared across all definitions in this section since they share the same body.
+		// When a count reaches 0, that VL element can be classified as text (Other)
+		// without waiting for all body references to resolve.
+		std::unordered_map<std::string, int> variableLikeCounts;
+		// Monomorphization: each argument type combination gets its own instantiation
+		std::map<std::vector<Type>, Instantiation> instantiations;
+		// Type inference: the body is inferred once per expansion
+		std::map<Expansion::Key, Expansion> expansions;
+		// the Expansion::Use flags of each symbol in the body, which includes the parameters
+		std::unordered_map<uint32_t, uint8_t> parameterUses;
+		// whether parameterUses is being found (the body calls itself) or was found
+		bool findingParameterUses = false;
+		bool parameterUsesFound = false;
+	};
+	// Most sections have neither, so the tables are null until the first entry is added
+	VariableTables *variableTables{};
+	DefinitionTables *definitionTables{};
 	// the start and end index of this section in compiled lines.
 	int startLineIndex, endLineIndex;
 	// count of unresolved pattern references + unresolved child sections
 	int unresolvedCount = 0;
 	// whether all pattern definitions in this section are resolved
 	bool patternDefinitionsResolved = false;
-	// Count of body references containing each VariableLike text.
-	// Shared across all definitions in this section since they share the same body.
-	// When a count reaches 0, that VL element can be classified as text (Other)
-	// without waiting for all body references to resolve.
-	std::unordered_map<std::string, int> variableLikeCounts;
 	// whether this is a macro (inlined at call site instead of function call)
 	bool isMacro = false;
 	// whether this sections patterns can be called from other files
 	bool isLocal = false;
+	// whether code reachable from the main file can run this section (set by resolvePatterns).
+	// only reachable sections are bound and inferred, so the unused bodies of imported definitions cost little
+	bool reachable = false;
 	// Control flow blocks for this section body (set by intrinsics like loop_while, if, etc.)
 	// exitBlock: where code continues after this section (always set for control flow)
 	// branchBackBlock: if set, branch here at end of body (for loops); null for if/switch
@@ -69,13 +89,14 @@ struct Section {
 	);
 	virtual bool processLine(ParseContext &context, CodeLine *line);
 	virtual Section *createSection(ParseContext &context, CodeLine *line);
-	Expression *detectPatterns(ParseContext &context, Range range, SectionType patternType);
-	Expression *detectPatternsRecursively(ParseContext &context, Range range, StringHierarchy *node, SectionType patternType);
 	void addVariableReference(ParseContext &context, VariableReference *reference);
 	void searchParentPatterns(ParseContext &context, VariableReference *reference);
 	void addPatternReference(PatternReference *reference);
 	void incrementUnresolved();
 	void decrementUnresolved();
+	// allocate the tables in the arena if this section has none yet
+	VariableTables &getVariableTables(Arena &arena);
+	DefinitionTables &getDefinitionTables(Arena &arena);
 
 	// Find a Variable by name in this section or parent scopes
 	Variable *findVariable(const std::string &name);
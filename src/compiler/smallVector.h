@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// A vector which keeps up to inlineCapacity elements inside itself, and only allocates when it grows beyond that.
+// Used for the short lists most front-end nodes have, like the arguments of an expression. Elements are copied bytewise.
+template <typename T, size_t inlineCapacity> class SmallVector {
+	static_assert(std::is_trivially_copyable_v<T>, "elements are copied bytewise");
+
+  public:
+	SmallVector() = default;
+	SmallVector(const SmallVector &other) { assign(other.begin(), other.end()); }
+	SmallVector &operator=(const SmallVector &other) {
+		if (this != &other)
+			assign(other.begin(), other.end());
+		return *this;
+	}
+	SmallVector &operator=(const std::vector<T> &other) {
+		assign(other.data(), other.data() + other.size());
+		return *this;
+	}
+	~SmallVector() {
+		if (elements != storage)
+			delete[] elements;
+	}
+
+	void pushBack(T value) {
+		if (count == capacity)
+			reserve(capacity * 2);
+		elements[count++] = value;
+	}
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T &operator[](size_t index) { return elements[index]; }
+	const T &operator[](size_t index) const { return elements[index]; }
+	T *data() { return elements; }
+	const T *data() const { return elements; }
+	T *begin() { return elements; }
+	T *end() { return elements + count; }
+	const T *begin() const { return elements; }
+	const T *end() const { return elements + count; }
+
+  private:
+	void assign(const T *first, const T *last) {
+		count = 0;
+		reserve(last - first);
+		std::copy(first, last, elements);
+		count = last - first;
+	}
+	void reserve(size_t wanted) {
+		if (wanted <= capacity)
+			return;
+		T *grown = new T[wanted];
+		std::copy(elements, elements + count, grown);
+		if (elements != storage)
+			delete[] elements;
+		elements = grown;
+		capacity = wanted;
+	}
+
+	T *elements = storage;
+	uint32_t count = 0;
+	uint32_t capacity = inlineCapacity;
+	T storage[inlineCapacity];
+};
@@ -0,0 +1,53 @@
+#include "typeDependencies.h"
+#include "expansion.h"
+
+TypeDependencies::TypeDependencies(size_t lineCount) : pending(lineCount, true), pendingCount(lineCount) {}
+
+bool TypeDependencies::visit(size_t lineIndex) {
+	if (!pending[lineIndex])
+		return false;
+	pending[lineIndex] = false;
+	pendingCount--;
+	currentReaders = {(uint32_t)lineIndex};
+	return true;
+}
+
+void TypeDependencies::enter(Expansion *expansion) {
+	auto [it, added] = expansionReaders.try_emplace(expansion, (uint32_t)(pending.size() + expansions.size()));
+	if (added)
+		expansions.push_back(expansion);
+	currentReaders.push_back(it->second);
+}
+
+void TypeDependencies::leave() { currentReaders.pop_back(); }
+
+void TypeDependencies::read(const void *type) {
+	std::vector<uint32_t> &typeReaders = readers[type];
+	// a line often reads the same type more than once
+	if (typeReaders.empty() || typeReaders.back() != currentReaders.back())
+		typeReaders.push_back(currentReaders.back());
+}
+
+void TypeDependencies::changed(const void *type) {
+	std::vector<const void *> changedTypes{type};
+	while (changedTypes.size()) {
+		auto typeReaders = readers.find(changedTypes.back());
+		changedTypes.pop_back();
+		if (typeReaders == readers.end())
+			continue;
+		for (uint32_t reader : typeReaders->second) {
+			if (reader >= pending.size()) {
+				Expansion *expansion = expansions[reader - pending.size()];
+				if (!expansion->stale) {
+					expansion->stale = true;
+					changedTypes.push_back(expansion);
+				}
+			} else if (!pending[reader]) {
+				pending[reader] = true;
+				pendingCount++;
+			}
+		}
+		// the readers register their reads again when they're visited
+		readers.erase(typeReaders);
+	}
+}
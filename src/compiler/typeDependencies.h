@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct Expansion;
+// Records which code lines read which inferred types during type inference, so a line is only visited again when a type
+// it read changed. A type is identified by the address of what holds it: the type of a Variable, the return type of an
+// Instantiation, the instantiations and field types of a ClassDefinition or the result of an Expansion.
+// Reads made while inferring the body of an expansion are made by the expansion. When one of those types changes, the
+// expansion becomes stale, which counts as a change of its result.
+class TypeDependencies {
+  public:
+	// all lines start pending
+	explicit TypeDependencies(size_t lineCount);
+
+	// returns whether the line has to be visited, and makes it the current line if so
+	bool visit(size_t lineIndex);
+	// the reads until leave() are made by the expansion
+	void enter(Expansion *expansion);
+	void leave();
+	// the current line or expansion reads the type
+	void read(const void *type);
+	// the type changed: the lines which read it have to be visited again.
+	// lines after the current line are visited in the same sweep, the others in the next one
+	void changed(const void *type);
+	bool anyPending() const { return pendingCount > 0; }
+
+  private:
+	// a reader is a line index, or the line count plus an index into expansions
+	std::vector<Expansion *> expansions;
+	std::unordered_map<Expansion *, uint32_t> expansionReaders;
+	// the readers which read a type since it last changed. a reader is listed again every time it's visited
+	std::unordered_map<const void *, std::vector<uint32_t>> readers;
+	std::vector<bool> pending;
+	size_t pendingCount{};
+	// the current line, followed by the expansions being inferred
+	std::vector<uint32_t> currentReaders{0};
+};
@@ -1,15 +1,20 @@
 #pragma once
 #include "range.h"
+#include "symbolTable.h"
 #include <string>
 
 namespace llvm {
 class AllocaInst;
 }
+struct Variable;
 
 struct VariableReference {
 	Range range;
 	std::string name;
 	VariableReference *definition{};
+	// set by bindVariables: the variable the name refers to in the scope of the reference, and the interned name
+	Variable *resolved{};
+	uint32_t symbol = noSymbol;
 	// stack allocation for this variable (set during codegen, only for definitions)
 	llvm::AllocaInst *alloca{};
 	VariableReference(Range range, const std::string &name) : range(range), name(name) {}
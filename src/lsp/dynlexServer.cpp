@@ -165,8 +165,8 @@ DynLexServer::PositionInfo DynLexServer::findElementAtPosition(const std::string
 		info.section = codeLine->section;
 
 		// Search for variable references at this position
-		if (codeLine->section) {
-			for (auto &[name, refs] : codeLine->section->variableReferences) {
+		if (codeLine->section && codeLine->section->variableTables) {
+			for (auto &[name, refs] : codeLine->section->variableTables->references) {
 				for (VariableReference *ref : refs) {
 					if (ref->range.line == codeLine && ref->range.start() <= pos.character &&
 						pos.character <= ref->range.end()) {
@@ -231,9 +231,11 @@ std::vector<int> DynLexServer::generateSemanticTokens(const std::string &uri) {
 	// Order: variables → pattern matches → pattern definitions → comments (small to big, earlier slices later)
 
 	std::function<void(Section *)> tokenizeVariables = [&](Section *section) {
-		for (auto &[name, refs] : section->variableReferences) {
-			for (VariableReference *ref : refs) {
-				addToken(ref->range, SemanticTokenType::Variable, ref->isDefinition());
+		if (section->variableTables) {
+			for (auto &[name, refs] : section->variableTables->references) {
+				for (VariableReference *ref : refs) {
+					addToken(ref->range, SemanticTokenType::Variable, ref->isDefinition());
+				}
 			}
 		}
 		for (Section *child : section->children) {
@@ -252,7 +254,7 @@ std::vector<int> DynLexServer::generateSemanticTokens(const std::string &uri) {
 
 		switch (expr->kind) {
 		case Expression::Kind::Literal:
-			if (std::holds_alternative<std::string>(expr->literalValue)) {
+			if (std::holds_alternative<std::string_view>(expr->literalValue)) {
 				addToken(expr->range, SemanticTokenType::String, false);
 			} else if (std::holds_alternative<int64_t>(expr->literalValue) ||
 					   std::holds_alternative<double>(expr->literalValue)) {
@@ -1,23 +1,36 @@
 #include "fileSystem.h"
 #include "fileFunctions.h"
+#include "mappedSourceFile.h"
 
 namespace lsp {
 
 SourceFile *LocalFileSystem::getFile(const std::string &path) {
 	// Check cache first
-	auto it = cache.find(path);
-	if (it != cache.end()) {
-		return it->second.get();
+	{
+		std::lock_guard lock(cacheMutex);
+		auto it = cache.find(path);
+		if (it != cache.end()) {
+			return it->second.get();
+		}
 	}
 
-	// Read from disk
-	std::string content;
-	if (!readStringFromFile(path, content)) {
-		return nullptr;
+	std::unique_ptr<SourceFile> file;
+	if (mapFiles) {
+		// empty or special files can't be mapped, they're read instead
+		file = MappedSourceFile::open(path);
+	}
+	if (!file) {
+		// Read from disk
+		std::string content;
+		if (!readStringFromFile(path, content)) {
+			return nullptr;
+		}
+		file = std::make_unique<SourceFile>(path, std::move(content));
 	}
 
-	// Cache and return
-	auto [inserted, _] = cache.emplace(path, std::make_unique<SourceFile>(path, std::move(content)));
+	// Cache and return. if another thread read the same file meanwhile, its file is kept
+	std::lock_guard lock(cacheMutex);
+	auto [inserted, _] = cache.emplace(path, std::move(file));
 	return inserted->second.get();
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "sourceFile.h"
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -17,15 +18,23 @@ class FileSystem {
 
 	// Get a source file by path. Returns nullptr if file doesn't exist or can't be read.
 	// Files are cached - subsequent calls with the same path return the same SourceFile*.
+	// The compiler reads the imported files on several threads, so this can be called from several threads at once.
 	virtual SourceFile *getFile(const std::string &path) = 0;
 };
 
 // Local file system implementation - reads directly from disk and caches results
 class LocalFileSystem : public FileSystem {
   public:
+	// mapFiles: memory map files instead of reading them. only use this when files won't change on disk while they're
+	// cached, like in a single CLI compilation.
+	explicit LocalFileSystem(bool mapFiles = false) : mapFiles(mapFiles) {}
+
 	SourceFile *getFile(const std::string &path) override;
 
   private:
+	bool mapFiles;
+	// guards the cache. files are read without holding it, so different files are read at the same time
+	std::mutex cacheMutex;
 	std::unordered_map<std::string, std::unique_ptr<SourceFile>> cache;
 };
 
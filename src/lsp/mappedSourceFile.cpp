@@ -0,0 +1,40 @@
+#include "mappedSourceFile.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lsp {
+
+#ifndef _WIN32
+std::unique_ptr<MappedSourceFile> MappedSourceFile::open(const std::string &path) {
+	int fileDescriptor = ::open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		return nullptr;
+	}
+	struct stat fileStatus{};
+	void *mapping = MAP_FAILED;
+	if (fstat(fileDescriptor, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode) && fileStatus.st_size > 0) {
+		mapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	}
+	// the mapping stays valid after closing the descriptor
+	close(fileDescriptor);
+	if (mapping == MAP_FAILED) {
+		return nullptr;
+	}
+	// source files are scanned front to back once
+	madvise(mapping, fileStatus.st_size, MADV_SEQUENTIAL);
+	return std::unique_ptr<MappedSourceFile>(new MappedSourceFile(path, (const char *)mapping, fileStatus.st_size));
+}
+
+MappedSourceFile::~MappedSourceFile() { munmap((void *)data, size); }
+#else
+// files aren't mapped on Windows, LocalFileSystem reads them instead
+std::unique_ptr<MappedSourceFile> MappedSourceFile::open(const std::string &) { return nullptr; }
+
+MappedSourceFile::~MappedSourceFile() {}
+#endif
+
+} // namespace lsp
@@ -0,0 +1,25 @@
+#pragma once
+#include "sourceFile.h"
+#include <memory>
+
+namespace lsp {
+
+// A read-only source file backed by a memory mapping of the file on disk, so the compiler can scan it without
+// reading it into a string first. Only suitable when the file doesn't change while it's mapped (the CLI).
+class MappedSourceFile : public SourceFile {
+  public:
+	// Map the file at path. Returns nullptr if it can't be mapped, for example when it's empty or not a regular file, and
+	// always on Windows.
+	static std::unique_ptr<MappedSourceFile> open(const std::string &path);
+	~MappedSourceFile() override;
+
+	std::string_view getText() const override { return {data, size}; }
+
+  private:
+	MappedSourceFile(const std::string &path, const char *data, size_t size) : SourceFile(path, {}), data(data), size(size) {}
+
+	const char *data;
+	size_t size;
+};
+
+} // namespace lsp
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 
 namespace lsp {
 
@@ -10,6 +11,9 @@ struct SourceFile {
 
 	std::string uri;
 	std::string content;
+
+	// the text to compile. subclasses can provide it without copying it into content
+	virtual std::string_view getText() const { return content; }
 };
 
 } // namespace lsp
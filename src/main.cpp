@@ -4,11 +4,32 @@
 #include "lsp/fileSystem.h"
 #include "lsp/stdioTransport.h"
 #include "parseContext.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
 #include <iostream>
 #include <thread>
 #include <unistd.h>
 #include <vector>
 
+// more threads than this only add overhead, even on large machines
+constexpr int maxJobs = 256;
+
+static void printUsage() {
+	std::cerr << "Usage: dynlex <file.dl> [--emit-llvm|--run] [-O0|-O1|-O2|-O3] [-march=native|-mcpu=name]"
+			  << " [-mattr=features] [-j count] [-o output]" << std::endl;
+}
+
+// parse the count of -j, capped at maxJobs. returns false if it isn't a positive number
+static bool parseJobCount(const std::string &text, int &jobs) {
+	int count = 0;
+	auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), count);
+	if (error != std::errc() || end != text.data() + text.size() || count < 1)
+		return false;
+	jobs = std::min(count, maxJobs);
+	return true;
+}
+
 // possible invocation: dynlex main.dl
 // will compile DynLex to an executable named main
 // to execute that executable: ./main
@@ -17,6 +38,12 @@
 // --lsp flag starts the language server on TCP port 5007
 // --stdio flag starts the language server on stdin/stdout (for MCP integration)
 // --emit-llvm outputs .ll file instead of executable
+// --run compiles the program in memory and runs it right away, instead of writing an executable. dynlex then exits with
+// the exit code of the program
+// -march=native or -mcpu=<name> generates code for the CPU of this machine or the named one, instead of one which runs on
+// every CPU of the architecture. -mattr=<features> enables or disables target features, like -mattr=+avx2,-avx512f
+// -j <count> sets the number of threads used for reading files, detecting expressions, matching patterns and generating
+// machine code (default: one per hardware thread). counts above maxJobs are capped
 int main(int argumentCount, char *argumentValues[]) {
 	std::vector<std::string> args(argumentValues + 1, argumentValues + argumentCount);
 
@@ -37,6 +64,8 @@ int main(int argumentCount, char *argumentValues[]) {
 			useStdio = true;
 		} else if (arg == "--emit-llvm") {
 			context.options.emitLLVM = true;
+		} else if (arg == "--run") {
+			context.options.run = true;
 		} else if (arg == "-O0") {
 			context.options.optimizationLevel = 0;
 		} else if (arg == "-O1") {
@@ -45,6 +74,19 @@ int main(int argumentCount, char *argumentValues[]) {
 			context.options.optimizationLevel = 2;
 		} else if (arg == "-O3") {
 			context.options.optimizationLevel = 3;
+		} else if (arg.starts_with("-march=")) {
+			context.options.targetCpu = arg.substr(7);
+		} else if (arg.starts_with("-mcpu=")) {
+			context.options.targetCpu = arg.substr(6);
+		} else if (arg.starts_with("-mattr=")) {
+			context.options.targetFeatures = arg.substr(7);
+		} else if (arg.starts_with("-j")) {
+			std::string count = arg.size() > 2 ? arg.substr(2) : i + 1 < args.size() ? args[++i] : "";
+			if (!parseJobCount(count, context.options.jobs)) {
+				std::cerr << "Invalid job count '" << count << "' (expected a positive number of threads)" << std::endl;
+				printUsage();
+				return 1;
+			}
 		} else if (arg.starts_with("-o")) {
 			if (arg.size() > 2) {
 				context.options.outputPath = arg.substr(2);
@@ -74,15 +116,17 @@ int main(int argumentCount, char *argumentValues[]) {
 	}
 
 	if (!inputFile.empty()) {
-		lsp::LocalFileSystem localFs;
+		// the CLI compiles once, so source files can be mapped instead of read
+		lsp::LocalFileSystem localFs(true);
 		context.fileSystem = &localFs;
 		context.options.inputPath = inputFile;
 		if (compile(inputFile, context)) {
 			generateCode(context);
 		}
 		context.printDiagnostics();
+		return context.exitCode;
 	} else {
-		std::cerr << "Usage: dynlex <file.dl> [--emit-llvm] [-O0|-O1|-O2|-O3] [-o output]" << std::endl;
+		printUsage();
 	}
 
 	return 0;